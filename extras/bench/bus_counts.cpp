@@ -0,0 +1,198 @@
+// Bus traffic of every case in micro_target/micro_cases.h: transactions,
+// messages and bytes per call, on the FakeI2CBus and FakeDS1302 emulators. The expected
+// counts are checked in as bus_counts.txt, so that a change adding a
+// register read shows up as a failed check and a diff of that file. Host
+// only:
+//
+//   g++ -std=gnu++11 -O2 -Isrc -o bus_counts extras/bench/bus_counts.cpp
+//       src/RTClib.cpp src/RTClib_linux.cpp
+//   ./bus_counts -c extras/bench/bus_counts.txt   # exits 1 on any difference
+//   ./bus_counts > extras/bench/bus_counts.txt    # after an intended change
+//
+// Each case runs once, in order, from fixed register images; counts of
+// methods that branch on chip state (setup(), startTempConv()) are those of
+// that sequence. For DS1302 a transaction and a message are both one CE
+// cycle, and the bytes are those clocked in (command included) and out, so
+// SCK pulses are 8 * (wr + rd).
+
+#include "RTClib.h"
+#include "micro_target/micro_cases.h"
+
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+struct Counts {
+  uint32_t transfers;
+  uint32_t messages;
+  uint32_t written;
+  uint32_t read;
+
+  bool operator!=(const Counts &other) const {
+    return transfers != other.transfers || messages != other.messages || written != other.written ||
+           read != other.read;
+  }
+};
+
+struct CountBench {
+  FakeI2CBus *buses[2];
+  FakeDS1302 *gpio;
+  // in run order, to print the table in the same order
+  std::map<std::string, Counts> counts;
+  std::string order;
+
+  template <typename F>
+  void run(const char *name, F f) {
+    for (FakeI2CBus *bus : buses) {
+      bus->resetStats();
+    }
+    gpio->resetStats();
+    f();
+
+    Counts c = {};
+    for (FakeI2CBus *bus : buses) {
+      c.transfers += bus->stats().transfers;
+      c.messages += bus->stats().messages;
+      c.written += bus->stats().written;
+      c.read += bus->stats().read;
+    }
+    c.transfers += gpio->stats().transfers;
+    c.messages += gpio->stats().transfers;
+    c.written += gpio->stats().written;
+    c.read += gpio->stats().read;
+    counts[name] = c;
+    order += name;
+    order += '\n';
+  }
+};
+
+static void print(const char *name, const Counts &c, FILE *out) {
+  fprintf(out, "%-64s %3u %3u %3u %3u\n", name, c.transfers, c.messages, c.written, c.read);
+}
+
+// name, then four counts at the end of the line
+static bool parse(char *line, std::string *name, Counts *c) {
+  uint32_t *fields[] = {&c->read, &c->written, &c->messages, &c->transfers};
+  char *end = line + strlen(line);
+  while (end > line && (end[-1] == '\n' || end[-1] == ' ')) {
+    --end;
+  }
+
+  for (uint32_t *field : fields) {
+    char *p = end;
+    while (p > line && p[-1] >= '0' && p[-1] <= '9') {
+      --p;
+    }
+    if (p == end) {
+      return false;
+    }
+    *field = strtoul(p, nullptr, 10);
+    end = p;
+    while (end > line && end[-1] == ' ') {
+      --end;
+    }
+  }
+
+  name->assign(line, end);
+  return !name->empty();
+}
+
+static int check(const char *path, const CountBench &bench) {
+  FILE *in = fopen(path, "r");
+  if (in == nullptr) {
+    perror(path);
+    return 2;
+  }
+
+  int failures = 0;
+  std::map<std::string, Counts> expected;
+  char line[256];
+  while (fgets(line, sizeof(line), in) != nullptr) {
+    std::string name;
+    Counts c;
+    if (line[0] == '#' || line[0] == '\n' || !parse(line, &name, &c)) {
+      continue;
+    }
+    expected[name] = c;
+
+    auto got = bench.counts.find(name);
+    if (got == bench.counts.end()) {
+      printf("gone:     %s\n", name.c_str());
+      ++failures;
+    } else if (got->second != c) {
+      printf("expected: ");
+      print(name.c_str(), c, stdout);
+      printf("got:      ");
+      print(name.c_str(), got->second, stdout);
+      ++failures;
+    }
+  }
+  fclose(in);
+
+  for (auto &kv : bench.counts) {
+    if (expected.find(kv.first) == expected.end()) {
+      printf("new:      ");
+      print(kv.first.c_str(), kv.second, stdout);
+      ++failures;
+    }
+  }
+
+  printf("%zu cases, %d differences\n", bench.counts.size(), failures);
+  return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+  // same images as the micro benchmark; DS1307 and DS3231 share 0x68
+  uint8_t ds1307_regs[0x40] = {0x56, 0x34, 0x12, 0x04, 0x29, 0x02, 0x24};
+  uint8_t ds3231_regs[0x13] = {0x56, 0x34, 0x12, 0x04, 0x29, 0x02, 0x24};
+  uint8_t rx8025t_regs[0x10] = {0x56, 0x34, 0x12, 0x10, 0x29, 0x02, 0x24};
+  uint8_t pcf8563_regs[0x10] = {0x00, 0x00, 0x56, 0x34, 0x12, 0x29, 0x04, 0x02, 0x24};
+  ds3231_regs[0x11] = 0x19;
+  ds3231_regs[0x12] = 0x40;
+
+  FakeI2CBus bus_a, bus_b;
+  bus_a.attach(0x68, ds1307_regs, sizeof(ds1307_regs));
+  bus_b.attach(0x68, ds3231_regs, sizeof(ds3231_regs));
+  bus_b.attach(0x32, rx8025t_regs, sizeof(rx8025t_regs));
+  bus_b.attach(0x51, pcf8563_regs, sizeof(pcf8563_regs));
+  TwoWire wire_a(FakeI2CBus::transfer, &bus_a);
+  TwoWire wire_b(FakeI2CBus::transfer, &bus_b);
+
+  // DS1302 on pins 2, 3 and 4
+  FakeDS1302 gpio(2, 3, 4);
+  const uint8_t ds1302_clock[] = {0x56, 0x34, 0x12, 0x29, 0x02, 0x04, 0x24};
+  memcpy(gpio.clock, ds1302_clock, sizeof(ds1302_clock));
+
+  DS1302 ds1302(2, 3, 4);
+  DS1307 ds1307(wire_a);
+  DS3231 ds3231(wire_b);
+  RX8025T rx8025t(wire_b);
+  PCF8563 pcf8563(wire_b);
+
+  CountBench bench;
+  bench.buses[0] = &bus_a;
+  bench.buses[1] = &bus_b;
+  bench.gpio = &gpio;
+
+  micro_cases::run_pure(bench);
+  micro_cases::run_bus(bench, wire_b, 0x68);
+  micro_cases::run_ds1302(bench, ds1302);
+  micro_cases::run_ds1307(bench, ds1307);
+  micro_cases::run_ds3231(bench, ds3231);
+  micro_cases::run_rx8025t(bench, rx8025t);
+  micro_cases::run_pcf8563(bench, pcf8563);
+
+  if (argc > 2 && strcmp(argv[1], "-c") == 0) {
+    return check(argv[2], bench);
+  }
+
+  printf("# Bus traffic per call, checked by bus_counts -c; see bus_counts.cpp.\n");
+  printf("# %-62s %3s %3s %3s %3s\n", "case", "txn", "msg", "wr", "rd");
+  char *names = strdup(bench.order.c_str());
+  for (char *name = strtok(names, "\n"); name != nullptr; name = strtok(nullptr, "\n")) {
+    print(name, bench.counts[name], stdout);
+  }
+  free(names);
+  return 0;
+}
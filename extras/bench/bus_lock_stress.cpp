@@ -0,0 +1,82 @@
+// Contention test for the bus lock policies: four threads share one TwoWire
+// and one emulated DS3231. Two read the (fixed) time and check every field,
+// one flips RS with setSQWFreq(), one flips BBSQW with setBBSQW() and reads
+// it back, which catches a read-modify-write of CTRL lost to the other.
+// Host only:
+//
+//   g++ -std=gnu++11 -O2 -pthread -Isrc -DRTCLIB_BUS_LOCK=MutexBusLock
+//       -o bus_lock_stress extras/bench/bus_lock_stress.cpp src/RTClib.cpp
+//       src/RTClib_linux.cpp
+//   ./bus_lock_stress [seconds]
+//
+// Exits nonzero if any thread saw a torn value. Built with the default
+// NoBusLock it is expected to fail (or crash, TwoWire is not thread-safe).
+
+#include "RTClib.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+// 2024-02-29 12:34:56, INTCN set
+static uint8_t regs[0x13] = {0x56, 0x34, 0x12, 0x04, 0x29, 0x02, 0x24};
+
+int main(int argc, char **argv) {
+  int seconds = argc > 1 ? atoi(argv[1]) : 2;
+  regs[0x0e] = 0x04;
+
+  FakeI2CBus bus;
+  bus.attach(DS3231::ADDRESS, regs, sizeof(regs));
+  TwoWire wire(FakeI2CBus::transfer, &bus);
+  DS3231 rtc(wire);
+
+  std::atomic<bool> stop {false};
+  std::atomic<uint32_t> torn {0}, calls {0};
+
+  auto reader = [&] {
+    while (!stop) {
+      tm t;
+      rtc.getTime(&t);
+      if (t.tm_sec != 56 || t.tm_min != 34 || t.tm_hour != 12 || t.tm_mday != 29 || t.tm_mon != 1 ||
+          t.tm_year != 124) {
+        ++torn;
+      }
+      ++calls;
+    }
+  };
+
+  auto rs = [&] {
+    for (uint8_t i = 0; !stop; ++i) {
+      rtc.setSQWFreq(i & 1 ? DS3231::SQW_8192HZ : DS3231::SQW_1HZ);
+      if (!rtc.getINTCN()) {
+        ++torn;
+      }
+      ++calls;
+    }
+  };
+
+  auto bbsqw = [&] {
+    for (uint8_t i = 0; !stop; ++i) {
+      bool on = i & 1;
+      rtc.setBBSQW(on);
+      if (rtc.getBBSQW() != on) {
+        ++torn;
+      }
+      ++calls;
+    }
+  };
+
+  std::thread threads[] = {std::thread(reader), std::thread(reader), std::thread(rs), std::thread(bbsqw)};
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  stop = true;
+  for (std::thread &t : threads) {
+    t.join();
+  }
+
+  BusLockStats stats = RTCLIB_BUS_LOCK::stats();
+  printf("%u calls, %u torn, %u of %u lock acquisitions contended\n", unsigned(calls), unsigned(torn),
+         unsigned(stats.contended), unsigned(stats.acquired));
+  return torn != 0;
+}
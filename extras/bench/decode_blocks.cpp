@@ -0,0 +1,171 @@
+// Throughput of decodeTimeBlocks() against the per-block scalar path and
+// against the bcd2bin() + mktime() decoding it replaces. Host only:
+//
+//   g++ -std=gnu++11 -O2 -Isrc -o decode_blocks extras/bench/decode_blocks.cpp
+//       src/RTClib.cpp src/RTClib_batch.cpp src/RTClib_linux.cpp
+//   ./decode_blocks [blocks]
+
+#include "RTClib.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using __rtclib_details::bin2bcd;
+using __rtclib_details::bcd2bin;
+using Clock = std::chrono::steady_clock;
+
+// fills one block the way each chip lays out its time registers
+static void encode(RawTime::Chip chip, const tm &t, uint8_t *b) {
+  uint8_t year = t.tm_year - 100;
+  uint8_t cen = 0;
+  if (year >= 100) {
+    year -= 100;
+    cen = 0x80;
+  }
+
+  b[0] = bin2bcd(t.tm_sec);
+  b[1] = bin2bcd(t.tm_min);
+  b[2] = bin2bcd(t.tm_hour);
+  b[6] = bin2bcd(year);
+
+  switch (chip) {
+    case RawTime::CHIP_DS1302:
+      b[3] = bin2bcd(t.tm_mday);
+      b[4] = bin2bcd(t.tm_mon + 1);
+      b[5] = t.tm_wday ? t.tm_wday : 7;
+      break;
+    case RawTime::CHIP_PCF8563:
+      b[3] = bin2bcd(t.tm_mday);
+      b[4] = t.tm_wday;
+      b[5] = bin2bcd(t.tm_mon + 1) | cen;
+      break;
+    case RawTime::CHIP_RX8025T:
+      b[3] = 1 << t.tm_wday;
+      b[4] = bin2bcd(t.tm_mday);
+      b[5] = bin2bcd(t.tm_mon + 1);
+      break;
+    default:
+      b[3] = t.tm_wday ? t.tm_wday : 7;
+      b[4] = bin2bcd(t.tm_mday);
+      b[5] = bin2bcd(t.tm_mon + 1) | (chip == RawTime::CHIP_DS3231 ? cen : 0);
+      break;
+  }
+}
+
+// what ingestion did before: decode into tm and let the C library do the
+// rest; DS1307-style layout only, other chips report 0 in that column
+static time_t decode_mktime(const uint8_t *b) {
+  tm t {};
+  t.tm_sec = bcd2bin(b[0] & 0x7f);
+  t.tm_min = bcd2bin(b[1] & 0x7f);
+  t.tm_hour = bcd2bin(b[2] & 0x3f);
+  t.tm_mday = bcd2bin(b[4] & 0x3f);
+  t.tm_mon = bcd2bin(b[5] & 0x1f) - 1;
+  t.tm_year = bcd2bin(b[6]) + 100 + ((b[5] & 0x80) ? 100 : 0);
+  return mktime(&t);
+}
+
+// Decodes the ends of the range and the point where the day count leaves 16
+// bits, through the scalar tail of decodeTimeBlocks() (3 blocks), toEpoch()
+// and toY2KSeconds() (modulo 2^32 past 2136); returns the number of
+// mismatches.
+static int check_bounds(RawTime::Chip chip, const char *name) {
+  static const time_t dates[] = {
+      946684800,  // 2000-01-01 00:00:00
+      6626966400, // 2180-01-01 00:00:00
+      6632064000, // 2180-02-29 00:00:00
+      7258118399, // 2199-12-31 23:59:59
+  };
+
+  int failed = 0;
+  for (time_t e : dates) {
+    uint8_t blocks[7 * 3];
+    tm t;
+    gmtime_r(&e, &t);
+    for (int i = 0; i < 3; ++i) {
+      encode(chip, t, &blocks[7 * i]);
+    }
+
+    time_t out[3];
+    decodeTimeBlocks(blocks, 3, out, chip);
+    RawTime raw;
+    raw.chip = chip;
+    memcpy(raw.regs, blocks, sizeof(raw.regs));
+    if (out[2] != e || raw.toEpoch() != e || raw.toY2KSeconds() != uint32_t(e - 946684800)) {
+      fprintf(stderr, "%s: %lld decodes as %lld/%lld/%lu\n", name, (long long)e, (long long)out[2],
+              (long long)raw.toEpoch(), (unsigned long)raw.toY2KSeconds());
+      ++failed;
+    }
+  }
+  return failed;
+}
+
+template <typename F>
+static double blocks_per_sec(size_t n, F f) {
+  auto start = Clock::now();
+  f();
+  std::chrono::duration<double> dt = Clock::now() - start;
+  return n / dt.count();
+}
+
+int main(int argc, char **argv) {
+  size_t n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 4000000;
+  setenv("TZ", "UTC", 1);
+  tzset();
+
+  static const char *names[] = {"DS1302", "DS1307", "DS3231", "RX8025T", "PCF8563"};
+  std::vector<uint8_t> blocks(7 * n);
+  std::vector<time_t> expect(n), out(n);
+  int failed = 0;
+
+  printf("chip,batch_blocks_per_s,scalar_blocks_per_s,mktime_blocks_per_s\n");
+  for (int c = RawTime::CHIP_DS1302; c <= RawTime::CHIP_PCF8563; ++c) {
+    RawTime::Chip chip = static_cast<RawTime::Chip>(c);
+    // DS3231 and PCF8563 carry a century bit, the others end in 2099
+    bool century = chip == RawTime::CHIP_DS3231 || chip == RawTime::CHIP_PCF8563;
+    double span = century ? 6311433600.0 : 3155716800.0;
+    if (century && check_bounds(chip, names[c]) != 0) {
+      failed = 1;
+    }
+
+    srand(c);
+    for (size_t i = 0; i < n; ++i) {
+      time_t e = 946684800 + static_cast<time_t>(rand() / (RAND_MAX + 1.0) * span);
+      tm t;
+      gmtime_r(&e, &t);
+      encode(chip, t, &blocks[7 * i]);
+      expect[i] = e;
+    }
+
+    double batch = blocks_per_sec(n, [&] { decodeTimeBlocks(blocks.data(), n, out.data(), chip); });
+    if (memcmp(out.data(), expect.data(), n * sizeof(time_t)) != 0) {
+      fprintf(stderr, "%s: batch decode mismatch\n", names[c]);
+      failed = 1;
+    }
+
+    double scalar = blocks_per_sec(n, [&] {
+      RawTime raw;
+      raw.chip = chip;
+      for (size_t i = 0; i < n; ++i) {
+        memcpy(raw.regs, &blocks[7 * i], 7);
+        out[i] = raw.toEpoch();
+      }
+    });
+
+    double libc = 0;
+    if (chip != RawTime::CHIP_DS1302 && chip != RawTime::CHIP_PCF8563) {
+      libc = blocks_per_sec(n, [&] {
+        for (size_t i = 0; i < n; ++i) {
+          out[i] = decode_mktime(&blocks[7 * i]);
+        }
+      });
+    }
+
+    printf("%s,%.0f,%.0f,%.0f\n", names[c], batch, scalar, libc);
+  }
+
+  return failed;
+}
@@ -0,0 +1,116 @@
+// Per-call cost of the conversion helpers and of every public chip method,
+// the latter over the FakeI2CBus and FakeDS1302 emulators so that the numbers
+// track the library code and not a real bus. Host only:
+//
+//   g++ -std=gnu++11 -O2 -Isrc -o micro extras/bench/micro.cpp
+//       src/RTClib.cpp src/RTClib_linux.cpp
+//   ./micro [out.json]
+//
+// Results are written as JSON (default micro.json), one record per case with
+// ns/op and, on x86, TSC cycles/op. The same cases run on a board through
+// micro_target/micro_target.ino.
+
+#include "RTClib.h"
+#include "micro_target/micro_cases.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define MICRO_HAVE_TSC
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+// each case is doubled until it runs for at least this long
+static const double MIN_SECONDS = 0.05;
+
+struct HostBench {
+  FILE *out;
+  bool first;
+
+  template <typename F>
+  void run(const char *name, F f) {
+    uint32_t n = 16;
+    double secs;
+    uint64_t cycles = 0;
+
+    for (;;) {
+#ifdef MICRO_HAVE_TSC
+      uint64_t c0 = __rdtsc();
+#endif
+      Clock::time_point t0 = Clock::now();
+      for (uint32_t i = 0; i < n; ++i) {
+        f();
+      }
+      secs = std::chrono::duration<double>(Clock::now() - t0).count();
+#ifdef MICRO_HAVE_TSC
+      cycles = __rdtsc() - c0;
+#endif
+      if (secs >= MIN_SECONDS || n >= (1u << 30)) {
+        break;
+      }
+      n *= 2;
+    }
+
+    double ns = secs * 1e9 / n;
+    double cyc = double(cycles) / n;
+    printf("%-48s %10.1f ns/op %10.1f cycles/op\n", name, ns, cyc);
+    fprintf(out, "%s\n  {\"name\": \"%s\", \"iterations\": %u, \"ns_per_op\": %.2f, \"cycles_per_op\": %.2f}",
+            first ? "" : ",", name, n, ns, cyc);
+    first = false;
+  }
+};
+
+int main(int argc, char **argv) {
+  const char *path = argc > 1 ? argv[1] : "micro.json";
+  FILE *out = fopen(path, "w");
+  if (out == nullptr) {
+    perror(path);
+    return 1;
+  }
+
+  // DS1307 and DS3231 share 0x68, so each gets a bus of its own
+  uint8_t ds1307_regs[0x40] = {0x56, 0x34, 0x12, 0x04, 0x29, 0x02, 0x24};
+  uint8_t ds3231_regs[0x13] = {0x56, 0x34, 0x12, 0x04, 0x29, 0x02, 0x24};
+  uint8_t rx8025t_regs[0x10] = {0x56, 0x34, 0x12, 0x10, 0x29, 0x02, 0x24};
+  uint8_t pcf8563_regs[0x10] = {0x00, 0x00, 0x56, 0x34, 0x12, 0x29, 0x04, 0x02, 0x24};
+  ds3231_regs[0x11] = 0x19;
+  ds3231_regs[0x12] = 0x40;
+
+  FakeI2CBus bus_a, bus_b;
+  bus_a.attach(0x68, ds1307_regs, sizeof(ds1307_regs));
+  bus_b.attach(0x68, ds3231_regs, sizeof(ds3231_regs));
+  bus_b.attach(0x32, rx8025t_regs, sizeof(rx8025t_regs));
+  bus_b.attach(0x51, pcf8563_regs, sizeof(pcf8563_regs));
+  TwoWire wire_a(FakeI2CBus::transfer, &bus_a);
+  TwoWire wire_b(FakeI2CBus::transfer, &bus_b);
+
+  // DS1302 on pins 2, 3 and 4
+  FakeDS1302 gpio(2, 3, 4);
+  const uint8_t ds1302_clock[] = {0x56, 0x34, 0x12, 0x29, 0x02, 0x04, 0x24};
+  memcpy(gpio.clock, ds1302_clock, sizeof(ds1302_clock));
+
+  DS1302 ds1302(2, 3, 4);
+  DS1307 ds1307(wire_a);
+  DS3231 ds3231(wire_b);
+  RX8025T rx8025t(wire_b);
+  PCF8563 pcf8563(wire_b);
+
+  HostBench bench {out, true};
+  fprintf(out, "{\"host\": true, \"cases\": [");
+
+  micro_cases::run_pure(bench);
+  micro_cases::run_bus(bench, wire_b, 0x68);
+  micro_cases::run_ds1302(bench, ds1302);
+  micro_cases::run_ds1307(bench, ds1307);
+  micro_cases::run_ds3231(bench, ds3231);
+  micro_cases::run_rx8025t(bench, rx8025t);
+  micro_cases::run_pcf8563(bench, pcf8563);
+
+  fprintf(out, "\n]}\n");
+  fclose(out);
+  return 0;
+}
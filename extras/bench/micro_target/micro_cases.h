@@ -0,0 +1,266 @@
+#ifndef __RTCLIB_MICRO_CASES_H__
+#define __RTCLIB_MICRO_CASES_H__
+
+// Micro-benchmark cases shared by the host runner (extras/bench/micro.cpp,
+// on the FakeI2CBus emulator) and micro_target.ino (on a real bus). A runner
+// provides Bench::run(name, f), which times repeated calls of f(); the
+// bus_counts checker calls each f() once and counts its bus traffic.
+//
+// DS1302 runs on the host against FakeDS1302, which stands in for the GPIO
+// pins; the sketch leaves it out. DS1307 shares 0x68 with DS3231; the sketch
+// runs DS3231 only.
+
+#include <RTClib.h>
+
+namespace micro_cases {
+  // static/inline so that more than one translation unit can include this
+  static volatile uint8_t sink;
+  static volatile uint8_t input = 0x59;
+
+  inline void on_intr(void *) { ++sink; }
+
+  template <typename Bench>
+  void run_pure(Bench &bench) {
+    using namespace __rtclib_details;
+
+    RawTime raw = {{0x56, 0x34, 0x12, 0x04, 0x29, 0x02, 0x24}, RawTime::CHIP_DS3231};
+    PackedTime packed = raw.toPacked();
+    tm t;
+
+    bench.run("bcd2bin", [&] { sink = bcd2bin(input); });
+    bench.run("bin2bcd", [&] { sink = bin2bcd(input & 0x3f); });
+    bench.run("RawTime::second", [&] { sink = raw.second(); });
+    bench.run("RawTime::toTm", [&] { raw.toTm(&t); sink = t.tm_sec; });
+    bench.run("RawTime::toEpoch", [&] { sink = raw.toEpoch(); });
+    bench.run("RawTime::toPacked", [&] { sink = raw.toPacked().value; });
+    bench.run("RawTime::operator<", [&] { sink = raw < raw; });
+    bench.run("PackedTime::toTm", [&] { packed.toTm(&t); sink = t.tm_sec; });
+    bench.run("PackedTime::operator-", [&] { sink = packed - packed; });
+  }
+
+  // bare 7-byte register read, the bus cost underneath every getTime()
+  template <typename Bench>
+  void run_bus(Bench &bench, TwoWire &wire, uint8_t dev) {
+    bench.run("wire_read7", [&] {
+      wire.beginTransmission(dev);
+      wire.write(0);
+      wire.endTransmission(false);
+      wire.requestFrom(dev, uint8_t(7));
+      while (wire.available()) {
+        sink = wire.read();
+      }
+    });
+  }
+
+#define MICRO_CASE(chip, call) bench.run(#chip "::" #call, [&] { rtc.call; })
+#define MICRO_CASE_SINK(chip, call) bench.run(#chip "::" #call, [&] { sink = rtc.call; })
+
+  // Setters write back values equal or close to what the chip already has,
+  // but setTime()/setAL*()/setAlarm() do overwrite: do not run this against
+  // a clock you care about.
+  template <typename Bench>
+  void run_ds1302(Bench &bench, DS1302 &rtc) {
+    tm t;
+    RawTime raw;
+    rtc.getTime(&t);
+    uint8_t buf[8];
+
+    MICRO_CASE_SINK(DS1302, setup());
+    MICRO_CASE(DS1302, getTime(&t));
+    MICRO_CASE_SINK(DS1302, getTimeChecked(&t));
+    MICRO_CASE_SINK(DS1302, getRawTimeChecked(&raw));
+    MICRO_CASE(DS1302, setTime(&t));
+    MICRO_CASE_SINK(DS1302, getRawTime().regs[0]);
+    MICRO_CASE_SINK(DS1302, readReg(0x81));
+    MICRO_CASE(DS1302, writeReg(0x8e, 0));
+    MICRO_CASE_SINK(DS1302, readRAM(0));
+    MICRO_CASE(DS1302, writeRAM(0, 0));
+    MICRO_CASE(DS1302, readRAM(0, buf, sizeof(buf)));
+    MICRO_CASE(DS1302, writeRAM(0, buf, sizeof(buf)));
+    MICRO_CASE(DS1302, writeRAM(8, buf, sizeof(buf)));
+    MICRO_CASE_SINK(DS1302, isRunning());
+    MICRO_CASE(DS1302, setRunning(true));
+    MICRO_CASE_SINK(DS1302, getTrickleCharger());
+    MICRO_CASE(DS1302, setTrickleCharger(DS1302::TC_OFF));
+  }
+
+  template <typename Bench>
+  void run_ds1307(Bench &bench, DS1307 &rtc) {
+    tm t;
+    RawTime raw;
+    rtc.getTime(&t);
+    uint8_t buf[8];
+
+    MICRO_CASE_SINK(DS1307, setup());
+    MICRO_CASE(DS1307, getTime(&t));
+    MICRO_CASE_SINK(DS1307, getTimeChecked(&t));
+    MICRO_CASE_SINK(DS1307, getRawTimeChecked(&raw));
+    MICRO_CASE(DS1307, setTime(&t));
+    MICRO_CASE_SINK(DS1307, getRawTime().regs[0]);
+    MICRO_CASE_SINK(DS1307, readReg(0));
+    MICRO_CASE(DS1307, writeReg(0x08, 0));
+    MICRO_CASE_SINK(DS1307, readRAM(0));
+    MICRO_CASE(DS1307, writeRAM(0, 0));
+    MICRO_CASE(DS1307, readRAM(0, buf, sizeof(buf)));
+    MICRO_CASE(DS1307, writeRAM(0, buf, sizeof(buf)));
+    MICRO_CASE_SINK(DS1307, isRunning());
+    MICRO_CASE(DS1307, setRunning(true));
+    MICRO_CASE_SINK(DS1307, getSQWOut());
+    MICRO_CASE(DS1307, setSQWOut(DS1307::SO_LOW));
+  }
+
+  template <typename Bench>
+  void run_ds3231(Bench &bench, DS3231 &rtc) {
+    tm t;
+    RawTime raw;
+    rtc.getTime(&t);
+    DS3231::Config cfg;
+
+    MICRO_CASE_SINK(DS3231, setup());
+    MICRO_CASE(DS3231, getTime(&t));
+    MICRO_CASE_SINK(DS3231, getTimeChecked(&t));
+    MICRO_CASE_SINK(DS3231, getRawTimeChecked(&raw));
+    MICRO_CASE(DS3231, setTime(&t));
+    MICRO_CASE_SINK(DS3231, getRawTime().regs[0]);
+    MICRO_CASE_SINK(DS3231, readReg(0));
+    MICRO_CASE(DS3231, writeReg(0x10, 0));
+    MICRO_CASE_SINK(DS3231, isRunning());
+    MICRO_CASE(DS3231, setRunning(true));
+    MICRO_CASE_SINK(DS3231, getINTCN());
+    MICRO_CASE(DS3231, setINTCN(true));
+    MICRO_CASE_SINK(DS3231, getBBSQW());
+    MICRO_CASE(DS3231, setBBSQW(false));
+    MICRO_CASE_SINK(DS3231, getSQWFreq());
+    MICRO_CASE(DS3231, setSQWFreq(DS3231::SQW_1HZ));
+    MICRO_CASE_SINK(DS3231, get32kHzOut());
+    MICRO_CASE(DS3231, set32kHzOut(true));
+    MICRO_CASE_SINK(DS3231, isIntrEnabled());
+    MICRO_CASE(DS3231, setIntrEnabled(true));
+    MICRO_CASE_SINK(DS3231, getAL1(&t));
+    MICRO_CASE(DS3231, setAL1(DS3231::AL1_MATCH_HOURS, &t));
+    MICRO_CASE_SINK(DS3231, isAL1IntrEnabled());
+    MICRO_CASE(DS3231, setAL1IntrEnabled(false));
+    MICRO_CASE_SINK(DS3231, getAL1IntrFlag());
+    MICRO_CASE(DS3231, clearAL1IntrFlag());
+    MICRO_CASE_SINK(DS3231, getAL2(&t));
+    MICRO_CASE(DS3231, setAL2(DS3231::AL2_MATCH_HOURS, &t));
+    MICRO_CASE_SINK(DS3231, isAL2IntrEnabled());
+    MICRO_CASE(DS3231, setAL2IntrEnabled(false));
+    MICRO_CASE_SINK(DS3231, getAL2IntrFlag());
+    MICRO_CASE(DS3231, clearAL2IntrFlag());
+    DS3231::IntrHandlers handlers = {on_intr, on_intr, nullptr};
+    MICRO_CASE_SINK(DS3231, serviceInterrupts(handlers));
+    MICRO_CASE(DS3231, setAlarms(DS3231::AL1_MATCH_HOURS, &t, DS3231::AL2_MATCH_HOURS, &t));
+    MICRO_CASE_SINK(DS3231, configure(cfg));
+    MICRO_CASE_SINK(DS3231, getAgingOffset());
+    MICRO_CASE(DS3231, setAgingOffset(0));
+    MICRO_CASE_SINK(DS3231, getTemperature());
+    MICRO_CASE_SINK(DS3231, getTemperatureQ());
+    MICRO_CASE_SINK(DS3231, startTempConv());
+    MICRO_CASE_SINK(DS3231, isTempConvDone());
+  }
+
+  template <typename Bench>
+  void run_rx8025t(Bench &bench, RX8025T &rtc) {
+    tm t;
+    RawTime raw;
+    rtc.getTime(&t);
+    tm al = t;
+    al.tm_wday = -1;
+    RX8025T::Config cfg;
+
+    MICRO_CASE_SINK(RX8025T, setup());
+    MICRO_CASE(RX8025T, getTime(&t));
+    MICRO_CASE_SINK(RX8025T, getTimeChecked(&t));
+    MICRO_CASE_SINK(RX8025T, getRawTimeChecked(&raw));
+    MICRO_CASE(RX8025T, setTime(&t));
+    MICRO_CASE_SINK(RX8025T, getRawTime().regs[0]);
+    MICRO_CASE_SINK(RX8025T, readReg(0));
+    MICRO_CASE(RX8025T, writeReg(0x07, 0));
+    MICRO_CASE_SINK(RX8025T, isRunning());
+    MICRO_CASE(RX8025T, setRunning(true));
+    MICRO_CASE_SINK(RX8025T, getTempCompInterval());
+    MICRO_CASE(RX8025T, setTempCompIntv(RX8025T::TC_2S));
+    MICRO_CASE_SINK(RX8025T, getRAM());
+    MICRO_CASE(RX8025T, setRAM(0));
+    uint8_t ram;
+    MICRO_CASE(RX8025T, readRAM(0, &ram, 1));
+    MICRO_CASE(RX8025T, writeRAM(0, &ram, 1));
+    MICRO_CASE_SINK(RX8025T, getTimer());
+    MICRO_CASE(RX8025T, setTimer(0));
+    MICRO_CASE_SINK(RX8025T, getTimerFreq());
+    MICRO_CASE(RX8025T, setTimerFreq(RX8025T::TF_OFF));
+    MICRO_CASE_SINK(RX8025T, isTimerIntrEnabled());
+    MICRO_CASE(RX8025T, setTimerIntrEnabled(false));
+    MICRO_CASE_SINK(RX8025T, getTimerFlag());
+    MICRO_CASE(RX8025T, clearTimerFlag());
+    MICRO_CASE_SINK(RX8025T, getFOUT());
+    MICRO_CASE(RX8025T, setFOUT(RX8025T::FOUT_1HZ));
+    MICRO_CASE_SINK(RX8025T, getVLF());
+    MICRO_CASE(RX8025T, clearVLF());
+    MICRO_CASE_SINK(RX8025T, getVDET());
+    MICRO_CASE(RX8025T, clearVDET());
+    MICRO_CASE_SINK(RX8025T, getUpdateFlag());
+    MICRO_CASE(RX8025T, clearUpdateFlag());
+    MICRO_CASE_SINK(RX8025T, getUSEL());
+    MICRO_CASE(RX8025T, setUSEL(false));
+    MICRO_CASE(RX8025T, getAlarm(&al));
+    MICRO_CASE(RX8025T, setAlarm(&al));
+    MICRO_CASE_SINK(RX8025T, isAlarmIntrEnabled());
+    MICRO_CASE(RX8025T, setAlarmIntrEnabled(false));
+    MICRO_CASE_SINK(RX8025T, getAlarmFlag());
+    MICRO_CASE(RX8025T, clearAlarmFlag());
+    RX8025T::IntrHandlers handlers = {on_intr, on_intr, on_intr, nullptr};
+    MICRO_CASE_SINK(RX8025T, serviceInterrupts(handlers));
+    MICRO_CASE_SINK(RX8025T, configure(cfg));
+  }
+
+  template <typename Bench>
+  void run_pcf8563(Bench &bench, PCF8563 &rtc) {
+    tm t;
+    RawTime raw;
+    rtc.getTime(&t);
+    tm al = t;
+    PCF8563::Config cfg;
+    uint8_t timer;
+
+    MICRO_CASE_SINK(PCF8563, setup());
+    MICRO_CASE(PCF8563, getTime(&t));
+    MICRO_CASE_SINK(PCF8563, getTimeChecked(&t));
+    MICRO_CASE_SINK(PCF8563, getRawTimeChecked(&raw));
+    MICRO_CASE(PCF8563, setTime(&t));
+    MICRO_CASE_SINK(PCF8563, getRawTime().regs[0]);
+    MICRO_CASE_SINK(PCF8563, readReg(0));
+    MICRO_CASE(PCF8563, writeReg(0x0f, 0));
+    MICRO_CASE_SINK(PCF8563, isRunning());
+    MICRO_CASE(PCF8563, setRunning(true));
+    MICRO_CASE_SINK(PCF8563, getCLKOut());
+    MICRO_CASE(PCF8563, setCLKOut(PCF8563::CLKOUT_32768HZ));
+    MICRO_CASE_SINK(PCF8563, getTimer());
+    MICRO_CASE(PCF8563, setTimer(0));
+    MICRO_CASE_SINK(PCF8563, getTimerFreq());
+    MICRO_CASE(PCF8563, setTimerFreq(PCF8563::TF_OFF));
+    MICRO_CASE_SINK(PCF8563, isTimerIntrEnabled());
+    MICRO_CASE(PCF8563, setTimerIntrEnabled(false));
+    MICRO_CASE_SINK(PCF8563, getTimerFlag());
+    MICRO_CASE(PCF8563, clearTimerFlag());
+    MICRO_CASE_SINK(PCF8563, isTimerPulseMode());
+    MICRO_CASE(PCF8563, setTimerPulseMode(false));
+    MICRO_CASE(PCF8563, getAlarm(&al));
+    MICRO_CASE(PCF8563, setAlarm(&al));
+    MICRO_CASE_SINK(PCF8563, isAlarmIntrEnabled());
+    MICRO_CASE(PCF8563, setAlarmIntrEnabled(false));
+    MICRO_CASE_SINK(PCF8563, getAlarmFlag());
+    MICRO_CASE(PCF8563, clearAlarmFlag());
+    PCF8563::IntrHandlers handlers = {on_intr, on_intr, nullptr};
+    MICRO_CASE_SINK(PCF8563, serviceInterrupts(handlers));
+    MICRO_CASE_SINK(PCF8563, configure(cfg));
+    MICRO_CASE(PCF8563, startSubSecTimer());
+    MICRO_CASE_SINK(PCF8563, getRawTime(&timer).regs[0]);
+  }
+
+#undef MICRO_CASE
+#undef MICRO_CASE_SINK
+} // namespace micro_cases
+
+#endif
@@ -0,0 +1,71 @@
+// On-target run of the micro-benchmark cases in micro_cases.h. Prints one
+// JSON record per case on Serial; capture the port to a file to compare with
+// the host numbers from extras/bench/micro.cpp.
+//
+// WARNING: the setter cases overwrite time and alarm registers. Only attach
+// chips whose state you can lose. Comment out the chips that are absent.
+
+#include <RTClib.h>
+#include <Wire.h>
+
+#include "micro_cases.h"
+
+// each case is doubled until it runs for at least this long
+static const uint32_t MIN_MICROS = 100000;
+
+struct TargetBench {
+  bool first;
+
+  template <typename F>
+  void run(const char *name, F f) {
+    uint32_t n = 1;
+    uint32_t us;
+
+    for (;;) {
+      uint32_t t0 = micros();
+      for (uint32_t i = 0; i < n; ++i) {
+        f();
+      }
+      us = micros() - t0;
+      if (us >= MIN_MICROS || n >= 0x10000) {
+        break;
+      }
+      n *= 2;
+    }
+
+    float ns = us * 1000.0f / n;
+    Serial.print(first ? F("") : F(","));
+    Serial.print(F("\n  {\"name\": \""));
+    Serial.print(name);
+    Serial.print(F("\", \"iterations\": "));
+    Serial.print(n);
+    Serial.print(F(", \"ns_per_op\": "));
+    Serial.print(ns, 1);
+    Serial.print(F(", \"cycles_per_op\": "));
+    Serial.print(ns * (F_CPU / 1000000UL) / 1000.0f, 1);
+    Serial.print('}');
+    first = false;
+  }
+};
+
+DS3231 ds3231;
+RX8025T rx8025t;
+PCF8563 pcf8563;
+
+void setup() {
+  Serial.begin(115200);
+  Wire.begin();
+
+  TargetBench bench {true};
+  Serial.print(F("{\"host\": false, \"cases\": ["));
+
+  micro_cases::run_pure(bench);
+  micro_cases::run_bus(bench, Wire, 0x68);
+  micro_cases::run_ds3231(bench, ds3231);
+  micro_cases::run_rx8025t(bench, rx8025t);
+  micro_cases::run_pcf8563(bench, pcf8563);
+
+  Serial.println(F("\n]}"));
+}
+
+void loop() {}
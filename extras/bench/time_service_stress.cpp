@@ -0,0 +1,178 @@
+// Contention test for TimeService: one poller publishing as fast as the
+// emulated DS3231 ticks, N readers checking every snapshot they get for
+// tearing. Then a phase check: start() runs against a DS3231 that follows
+// the host clock, with its seconds rolling over mid-way through the host
+// second, and a reader checks that snapshots lag the rollover by no more
+// than a few polls once the first rollover has been seen. Host only:
+//
+//   g++ -std=gnu++11 -O2 -pthread -Isrc -o time_service_stress
+//       extras/bench/time_service_stress.cpp src/RTClib.cpp src/RTClib_linux.cpp
+//   ./time_service_stress [readers] [seconds]
+//
+// Exits nonzero if any reader saw an inconsistent or backwards snapshot, or
+// a stale one after the phase should have settled.
+
+#include "RTClib.h"
+#include "RTClib_service.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+using __rtclib_details::bcd2bin;
+using __rtclib_details::bin2bcd;
+
+static uint8_t regs[0x13] = {0x00, 0x00, 0x00, 0x06, 0x01, 0x01, 0x00};
+
+// every transfer advances the emulated clock by one second
+static int ticking_transfer(void *ctx, int fd, i2c_msg *msgs, uint32_t nmsgs) {
+  static const uint8_t mdays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+  // seconds, minutes, hours, then day of month, month and year
+  static const uint8_t idx[] = {0, 1, 2, 4, 5, 6};
+  uint8_t val[6];
+  for (uint8_t i = 0; i < 6; ++i) {
+    val[i] = bcd2bin(regs[idx[i]] & 0x7f);
+  }
+
+  uint8_t mdays_now = mdays[val[4] - 1] + (val[4] == 2 && val[5] % 4 == 0);
+  const uint8_t limit[] = {60, 60, 24, uint8_t(mdays_now + 1), 13, 100};
+  const uint8_t first[] = {0, 0, 0, 1, 1, 0};
+  for (uint8_t i = 0; i < 6; ++i) {
+    if (++val[i] < limit[i]) {
+      break;
+    }
+    val[i] = first[i];
+  }
+
+  for (uint8_t i = 0; i < 6; ++i) {
+    regs[idx[i]] = bin2bcd(val[i]);
+  }
+
+  return FakeI2CBus::transfer(ctx, fd, msgs, nmsgs);
+}
+
+// a DS3231 whose seconds follow the host's steady clock from wall_origin
+static uint8_t wall_regs[0x13];
+static std::chrono::steady_clock::time_point wall_origin;
+static const time_t wall_base = 1704067200; // 2024-01-01
+
+static double wall_now() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_origin).count();
+}
+
+static int wall_transfer(void *ctx, int fd, i2c_msg *msgs, uint32_t nmsgs) {
+  time_t now = wall_base + time_t(wall_now());
+  tm t;
+  gmtime_r(&now, &t);
+  wall_regs[0] = bin2bcd(t.tm_sec);
+  wall_regs[1] = bin2bcd(t.tm_min);
+  wall_regs[2] = bin2bcd(t.tm_hour);
+  wall_regs[3] = t.tm_wday ? t.tm_wday : 7;
+  wall_regs[4] = bin2bcd(t.tm_mday);
+  wall_regs[5] = bin2bcd(t.tm_mon + 1);
+  wall_regs[6] = bin2bcd(t.tm_year - 100);
+  return FakeI2CBus::transfer(ctx, fd, msgs, nmsgs);
+}
+
+// Runs start() for the given time and counts samples whose snapshot is a
+// second behind the chip more than lateMs after a rollover, once settleS
+// has passed. start() comes half-way into a chip second, so a poller that
+// sleeps from the first publication lags by about half a second and then
+// catches up by only a few ms per second.
+static unsigned long phase_check(unsigned seconds, unsigned long *samples) {
+  const uint16_t pollMs = 5;
+  const double settleS = 1.2, lateMs = 50;
+
+  FakeI2CBus bus;
+  bus.attach(0x68, wall_regs, sizeof(wall_regs));
+  TwoWire wire(wall_transfer, &bus);
+  DS3231 rtc(wire);
+  TimeService<DS3231> svc(rtc);
+
+  wall_origin = std::chrono::steady_clock::now() - std::chrono::milliseconds(500);
+  svc.start(pollMs);
+
+  unsigned long late = 0;
+  *samples = 0;
+  TimeService<DS3231>::Snapshot s;
+  for (double t = wall_now(); t < seconds + 0.5; t = wall_now()) {
+    if (t - 0.5 >= settleS && svc.read(&s)) {
+      double into = t - double(long(t));
+      if (s.epoch < wall_base + time_t(t) && into * 1000 > lateMs) {
+        ++late;
+      }
+      ++*samples;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  svc.stop();
+  return late;
+}
+
+int main(int argc, char **argv) {
+  unsigned readers = argc > 1 ? atoi(argv[1]) : 4;
+  unsigned seconds = argc > 2 ? atoi(argv[2]) : 3;
+
+  FakeI2CBus bus;
+  bus.attach(0x68, regs, sizeof(regs));
+  TwoWire wire(ticking_transfer, &bus);
+  DS3231 rtc(wire);
+  TimeService<DS3231> svc(rtc);
+
+  std::atomic<bool> done {false};
+  std::atomic<unsigned long> reads {0}, errors {0};
+
+  std::thread poller([&] {
+    while (!done) {
+      svc.poll();
+    }
+  });
+
+  std::vector<std::thread> pool;
+  for (unsigned i = 0; i < readers; ++i) {
+    pool.emplace_back([&] {
+      TimeService<DS3231>::Snapshot s;
+      uint32_t lastSeq = 0;
+      time_t lastEpoch = 0;
+      unsigned long n = 0, bad = 0;
+
+      while (!done) {
+        if (!svc.read(&s)) {
+          continue;
+        }
+        ++n;
+        if (!s.valid || s.raw.toEpoch() != s.epoch || s.sequence < lastSeq ||
+            (s.sequence > lastSeq && s.epoch <= lastEpoch && lastSeq != 0)) {
+          ++bad;
+        }
+        lastSeq = s.sequence;
+        lastEpoch = s.epoch;
+      }
+      reads += n;
+      errors += bad;
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  done = true;
+  poller.join();
+  for (auto &t : pool) {
+    t.join();
+  }
+
+  TimeService<DS3231>::Snapshot last;
+  svc.read(&last);
+  printf("readers,publications,reads,errors\n%u,%u,%lu,%lu\n", readers, last.sequence, reads.load(),
+         errors.load());
+
+  unsigned long samples;
+  unsigned long late = phase_check(seconds, &samples);
+  printf("phase samples,late\n%lu,%lu\n", samples, late);
+  return errors || late ? 1 : 0;
+}
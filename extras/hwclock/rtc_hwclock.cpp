@@ -0,0 +1,560 @@
+// hwclock for the I2C chips, to the millisecond. Host only:
+//
+//   g++ -std=gnu++11 -O2 -Isrc -o rtc_hwclock extras/hwclock/rtc_hwclock.cpp
+//       src/RTClib.cpp src/RTClib_linux.cpp
+//   ./rtc_hwclock [-b bus] [-g gpiochip:line[:rising]] [-E offset_s[,drift_ppm]] [-n]
+//                 [-r | -s | -w | -d interval_s [-c count]]
+//
+// The chip is found with detectRTC() on /dev/i2c-<bus> (default 1). Its time
+// is only known to the second, so everything starts from a second edge: the
+// host time at which the seconds register advanced.
+//
+// Without -g the edge is bisected. The first read tells the second the chip
+// is in; each further read, timed to a chosen phase of a later second, tells
+// whether the edge comes before or after that phase and halves the interval.
+// Reads go on until the interval is as short as a read, about 11 reads over
+// 6-8 s on a 100 kHz bus, instead of polling through a whole second. The
+// chip's drift over those seconds adds to the error, 0.1 ms at 10 ppm.
+//
+// -g takes the edge from the chip's 1 Hz output wired to a GPIO line, with
+// the kernel's event timestamp, and switches that output on: SQW on DS3231
+// (alarm interrupts off), SQW/OUT on DS1307, FOUT on RX8025T, CLKOUT on
+// PCF8563. The falling edge is used unless :rising is given; a read just
+// before the next edge checks that it is the one advancing the seconds.
+//
+//   -r  prints the chip time, its offset from the system clock and the
+//       chip's status (default)
+//   -s  steps the system clock to the chip (hctosys); refused unless the
+//       chip's status is ok, i.e. it never stopped or lost power
+//   -w  sets the chip to the system clock (systohc): writes at a second
+//       boundary, starts the oscillator and clears OSF/VLF, measures what
+//       the write latency left, writes again ahead by that much and reports
+//       the residual
+//   -d  measures the offset every interval_s, count times or forever, and
+//       prints CSV lines: time,offset_ms,polls,drift_ppm,status (least
+//       squares fit over all samples so far, chip fast is positive)
+//   -n  dry run, -s only reports the step
+//
+// -E runs against an emulated DS3231 instead of the bus, offset_s off the
+// system clock and drift_ppm fast, with 100 kHz bus timing and the divider
+// restarting when the seconds are written; -s is then a dry run.
+
+#include "RTClib.h"
+
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <linux/i2c.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+static const int64_t USEC = 1000000;
+static const int64_t Y2K_EPOCH = 946684800;
+
+static int64_t clock_us(clockid_t clock) {
+  timespec ts;
+  clock_gettime(clock, &ts);
+  return int64_t(ts.tv_sec) * USEC + ts.tv_nsec / 1000;
+}
+
+static int64_t realtime_us() {
+  return clock_us(CLOCK_REALTIME);
+}
+
+static void sleep_until(int64_t target) {
+  // coarse sleep, then spin through the last 2 ms
+  int64_t wake = target - 2000;
+  if (wake > realtime_us()) {
+    timespec ts = {time_t(wake / USEC), long(wake % USEC) * 1000};
+    while (clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &ts, nullptr) != 0) {
+    }
+  }
+  while (realtime_us() < target) {
+  }
+}
+
+// Emulated DS3231 for -E. Reads latch the time when the transfer starts,
+// a seconds write restarts the divider when it ends.
+namespace emulated {
+  static uint8_t regs[0x13];
+  // chip seconds since 2000 at base, and how fast they run
+  static double chip_base;
+  static double base;
+  static double rate = 1.0;
+
+  static double now() {
+    return realtime_us() * 1e-6;
+  }
+
+  static int transfer(void *ctx, int fd, i2c_msg *msgs, uint32_t nmsgs) {
+    time_t secs = time_t(chip_base + (now() - base) * rate) + Y2K_EPOCH;
+    tm t;
+    gmtime_r(&secs, &t);
+    regs[0] = __rtclib_details::bin2bcd(t.tm_sec);
+    regs[1] = __rtclib_details::bin2bcd(t.tm_min);
+    regs[2] = __rtclib_details::bin2bcd(t.tm_hour);
+    regs[3] = t.tm_wday + 1;
+    regs[4] = __rtclib_details::bin2bcd(t.tm_mday);
+    regs[5] = __rtclib_details::bin2bcd(t.tm_mon + 1);
+    regs[6] = __rtclib_details::bin2bcd(t.tm_year - 100);
+
+    int ret = FakeI2CBus::transfer(ctx, fd, msgs, nmsgs);
+
+    // 9 bit times at 100 kHz per byte, address bytes included
+    int64_t bytes = 0;
+    for (uint32_t i = 0; i < nmsgs; ++i) {
+      bytes += 1 + msgs[i].len;
+    }
+    int64_t end = realtime_us() + bytes * 90;
+    while (realtime_us() < end) {
+    }
+
+    for (uint32_t i = 0; i < nmsgs; ++i) {
+      if ((msgs[i].flags & I2C_M_RD) == 0 && msgs[i].len > 1 && msgs[i].buf[0] == 0x00) {
+        RawTime raw;
+        memcpy(raw.regs, regs, sizeof(raw.regs));
+        raw.chip = RawTime::CHIP_DS3231;
+        chip_base = raw.toY2KSeconds();
+        base = now();
+      }
+    }
+    return ret;
+  }
+} // namespace emulated
+
+struct Options {
+  char action;
+  bool dryRun;
+  // 1 Hz line, -1 without -g
+  int gpio;
+  uint32_t interval;
+  uint32_t count;
+};
+
+// the host time at which the chip's seconds became y2k
+struct Edge {
+  int64_t host;
+  uint32_t y2k;
+  uint8_t polls;
+  // from the read that placed the edge
+  TimeStatus status;
+
+  // chip minus host, us
+  int64_t offset() const { return (int64_t(y2k) + Y2K_EPOCH) * USEC - host; }
+};
+
+static const char *status_name(TimeStatus status) {
+  switch (status) {
+    case TIME_OK:
+      return "ok";
+    case TIME_LOST:
+      return "lost";
+    case TIME_STOPPED:
+      return "stopped";
+    default:
+      return "invalid";
+  }
+}
+
+// false only for registers out of range; a chip that lost its time still
+// counts seconds, and its edge can be found and reported
+template <typename RTC>
+static bool probe(RTC &rtc, int64_t *at, uint32_t *y2k, int64_t *took, TimeStatus *status) {
+  RawTime raw;
+  *at = realtime_us();
+  *status = rtc.getRawTimeChecked(&raw);
+  *took = realtime_us() - *at;
+  *y2k = raw.toY2KSeconds();
+  return *status != TIME_INVALID;
+}
+
+template <typename RTC>
+static bool bisect_edge(RTC &rtc, Edge *edge) {
+  int64_t t0, took;
+  uint32_t s0;
+  if (!probe(rtc, &t0, &s0, &took, &edge->status)) {
+    return false;
+  }
+  edge->polls = 1;
+
+  // phase of the edge after t0, in (lo, hi]
+  int64_t lo = 0, hi = USEC;
+  int64_t resolution = took > 100 ? took : 100;
+  while (hi - lo > resolution) {
+    if (edge->polls >= 40) {
+      return false;
+    }
+
+    // the first second in which that phase is still ahead
+    int64_t mid = (lo + hi) / 2;
+    int64_t n = (realtime_us() + 1000 - t0 - mid + USEC - 1) / USEC;
+    if (n < 0) {
+      n = 0;
+    }
+    sleep_until(t0 + n * USEC + mid);
+
+    int64_t t;
+    uint32_t s;
+    bool ok = probe(rtc, &t, &s, &took, &edge->status);
+    ++edge->polls;
+    int64_t phase = t - t0 - n * USEC;
+    if (!ok || phase <= lo || phase >= hi) {
+      // overslept past the interval, nothing learned
+      continue;
+    }
+
+    if (s == s0 + n + 1) {
+      hi = phase;
+    } else if (s == s0 + n) {
+      lo = phase;
+    } else {
+      // stopped, or set meanwhile
+      fprintf(stderr, "chip does not count seconds\n");
+      return false;
+    }
+  }
+
+  edge->host = t0 + (lo + hi) / 2;
+  edge->y2k = s0 + 1;
+  return true;
+}
+
+// spec is gpiochipN:line[:rising], returns the line's event fd or -1
+static int gpio_open(const char *spec) {
+  char chip[32];
+  unsigned line;
+  char edge[16] = "falling";
+  if (sscanf(spec, "%31[^:]:%u:%15s", chip, &line, edge) < 2) {
+    fprintf(stderr, "bad GPIO spec %s\n", spec);
+    return -1;
+  }
+
+  char path[48];
+  snprintf(path, sizeof(path), "/dev/%s", chip);
+  int fd = open(path, O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    perror(path);
+    return -1;
+  }
+
+  gpio_v2_line_request req;
+  memset(&req, 0, sizeof(req));
+  req.offsets[0] = line;
+  req.num_lines = 1;
+  strcpy(req.consumer, "rtc_hwclock");
+  req.config.flags = GPIO_V2_LINE_FLAG_INPUT |
+                     (strcmp(edge, "rising") == 0 ? GPIO_V2_LINE_FLAG_EDGE_RISING : GPIO_V2_LINE_FLAG_EDGE_FALLING);
+  int ret = ioctl(fd, GPIO_V2_GET_LINE_IOCTL, &req);
+  close(fd);
+  if (ret < 0) {
+    perror("GPIO_V2_GET_LINE_IOCTL");
+    return -1;
+  }
+  return req.fd;
+}
+
+// next edge on the line, as host realtime
+static bool gpio_wait(int fd, int timeout, int64_t *at) {
+  pollfd pfd = {fd, POLLIN, 0};
+  gpio_v2_line_event event;
+  if (poll(&pfd, 1, timeout) <= 0 || read(fd, &event, sizeof(event)) != sizeof(event)) {
+    return false;
+  }
+  // events are stamped on CLOCK_MONOTONIC
+  *at = int64_t(event.timestamp_ns / 1000) + (realtime_us() - clock_us(CLOCK_MONOTONIC));
+  return true;
+}
+
+template <typename RTC>
+static bool gpio_edge(RTC &rtc, int fd, Edge *edge) {
+  // an edge that is already queued may be long gone
+  int64_t at, t, took;
+  while (gpio_wait(fd, 0, &at)) {
+  }
+  if (!gpio_wait(fd, 2000, &at)) {
+    fprintf(stderr, "no edge on the GPIO line\n");
+    return false;
+  }
+
+  uint32_t s, s2;
+  if (!probe(rtc, &t, &s, &took, &edge->status)) {
+    return false;
+  }
+  sleep_until(at + USEC - 20000);
+  if (!probe(rtc, &t, &s2, &took, &edge->status)) {
+    return false;
+  }
+  edge->polls = 2;
+  if (s2 != s) {
+    fprintf(stderr, "the seconds do not advance on this edge, try the other one\n");
+    return false;
+  }
+
+  edge->host = at;
+  edge->y2k = s;
+  return true;
+}
+
+static void enable_1hz(DS1307 &rtc) {
+  rtc.setSQWOut(DS1307::SO_1HZ);
+}
+
+static void enable_1hz(DS3231 &rtc) {
+  rtc.setINTCN(false);
+  rtc.setSQWFreq(DS3231::SQW_1HZ);
+}
+
+static void enable_1hz(RX8025T &rtc) {
+  rtc.setFOUT(RX8025T::FOUT_1HZ);
+}
+
+static void enable_1hz(PCF8563 &rtc) {
+  rtc.setCLKOut(PCF8563::CLKOUT_1HZ);
+}
+
+// after -w, so that the chip's status says its time can be trusted again;
+// PCF8563 clears VL on setTime()
+template <typename RTC>
+static void mark_set(RTC &rtc) {
+  rtc.setRunning(true);
+}
+
+static void mark_set(DS3231 &rtc) {
+  rtc.setRunning(true);
+  rtc.clearOSF();
+}
+
+static void mark_set(RX8025T &rtc) {
+  rtc.setRunning(true);
+  rtc.clearVLF();
+}
+
+template <typename RTC>
+static bool find_edge(RTC &rtc, const Options &opt, Edge *edge) {
+  if (opt.gpio >= 0 ? gpio_edge(rtc, opt.gpio, edge) : bisect_edge(rtc, edge)) {
+    return true;
+  }
+  fprintf(stderr, "no second edge found\n");
+  return false;
+}
+
+static void print_time(int64_t us) {
+  time_t secs = us / USEC;
+  tm t;
+  gmtime_r(&secs, &t);
+  printf("%04d-%02d-%02d %02d:%02d:%02d.%03d UTC", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min,
+         t.tm_sec, int(us % USEC / 1000));
+}
+
+// writes the fields of the host second starting at `at`, at + lead
+template <typename RTC>
+static void set_at(RTC &rtc, int64_t at, int64_t lead) {
+  time_t secs = at / USEC;
+  tm t;
+  gmtime_r(&secs, &t);
+  sleep_until(at + lead);
+  rtc.setTime(&t);
+}
+
+template <typename RTC>
+static int run(RTC &rtc, const Options &opt) {
+  Edge edge;
+
+  switch (opt.action) {
+    case 'r': {
+      if (!find_edge(rtc, opt, &edge)) {
+        return 1;
+      }
+      print_time(realtime_us() + edge.offset());
+      printf("  offset %+.3f ms (%u reads)  status %s\n", edge.offset() / 1000.0, edge.polls,
+             status_name(edge.status));
+      return 0;
+    }
+
+    case 's': {
+      if (!find_edge(rtc, opt, &edge)) {
+        return 1;
+      }
+      if (edge.status != TIME_OK) {
+        fprintf(stderr, "chip time not trusted (status %s), system clock left alone\n", status_name(edge.status));
+        return 1;
+      }
+      if (opt.dryRun) {
+        printf("would step the system clock by %+.3f ms\n", edge.offset() / 1000.0);
+        return 0;
+      }
+
+      int64_t now = realtime_us() + edge.offset();
+      timespec ts = {time_t(now / USEC), long(now % USEC) * 1000};
+      if (clock_settime(CLOCK_REALTIME, &ts) != 0) {
+        perror("clock_settime");
+        return 1;
+      }
+      printf("stepped the system clock by %+.3f ms\n", edge.offset() / 1000.0);
+      return 0;
+    }
+
+    case 'w': {
+      // at least 200 ms to get ready for the boundary
+      int64_t at = (realtime_us() + 200000) / USEC * USEC + USEC;
+      set_at(rtc, at, 0);
+      mark_set(rtc);
+      if (!find_edge(rtc, opt, &edge)) {
+        return 1;
+      }
+      // chip behind by the write latency: write that much earlier
+      int64_t lead = edge.offset();
+      printf("first write: offset %+.3f ms\n", lead / 1000.0);
+
+      at = (realtime_us() + 200000 - lead) / USEC * USEC + USEC;
+      set_at(rtc, at, lead);
+      if (!find_edge(rtc, opt, &edge)) {
+        return 1;
+      }
+      printf("offset %+.3f ms  status %s\n", edge.offset() / 1000.0, status_name(edge.status));
+      return 0;
+    }
+
+    case 'd': {
+      double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+      int64_t first = 0;
+      int64_t next = realtime_us();
+      for (uint32_t i = 0; opt.count == 0 || i < opt.count; ++i) {
+        sleep_until(next);
+        next += int64_t(opt.interval) * USEC;
+        if (!find_edge(rtc, opt, &edge)) {
+          continue;
+        }
+
+        // offset in us against time in s, so the slope is in ppm
+        if (n == 0) {
+          first = edge.host;
+        }
+        double x = (edge.host - first) * 1e-6, y = edge.offset();
+        n += 1;
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+
+        print_time(edge.host);
+        printf(",%.3f,%u,", y / 1000.0, edge.polls);
+        double den = n * sxx - sx * sx;
+        if (n > 1 && den > 0) {
+          printf("%.2f", (n * sxy - sx * sy) / den);
+        }
+        printf(",%s\n", status_name(edge.status));
+        fflush(stdout);
+      }
+      return 0;
+    }
+  }
+  return 2;
+}
+
+int main(int argc, char **argv) {
+  Options opt = {'r', false, -1, 0, 0};
+  uint8_t bus = 1;
+  const char *gpio = nullptr;
+  const char *emulate = nullptr;
+
+  int opt_char;
+  while ((opt_char = getopt(argc, argv, "b:g:E:nrswd:c:")) != -1) {
+    switch (opt_char) {
+      case 'b':
+        bus = atoi(optarg);
+        break;
+      case 'g':
+        gpio = optarg;
+        break;
+      case 'E':
+        emulate = optarg;
+        break;
+      case 'n':
+        opt.dryRun = true;
+        break;
+      case 'r':
+      case 's':
+      case 'w':
+        opt.action = opt_char;
+        break;
+      case 'd':
+        opt.action = 'd';
+        opt.interval = atoi(optarg);
+        break;
+      case 'c':
+        opt.count = atoi(optarg);
+        break;
+      default:
+        fprintf(stderr,
+                "usage: %s [-b bus] [-g gpiochip:line[:rising]] [-E offset_s[,drift_ppm]] [-n]\n"
+                "       [-r | -s | -w | -d interval_s [-c count]]\n",
+                argv[0]);
+        return 2;
+    }
+  }
+
+  FakeI2CBus fake;
+  TwoWire i2cdev(bus);
+  TwoWire emulatedWire(emulated::transfer, &fake);
+  TwoWire &wire = emulate ? emulatedWire : i2cdev;
+  if (emulate) {
+    double offset = 0, drift = 0;
+    sscanf(emulate, "%lf,%lf", &offset, &drift);
+    emulated::base = emulated::now();
+    emulated::chip_base = emulated::base - Y2K_EPOCH + offset;
+    emulated::rate = 1 + drift * 1e-6;
+    fake.attach(0x68, emulated::regs, sizeof(emulated::regs));
+    opt.dryRun = true;
+  } else if (!wire.begin()) {
+    fprintf(stderr, "cannot open /dev/i2c-%u\n", bus);
+    return 1;
+  }
+
+  RawTime::Chip chip;
+  if (!detectRTC(wire).best(&chip)) {
+    fprintf(stderr, "no RTC found\n");
+    return 1;
+  }
+
+  if (gpio != nullptr && (opt.gpio = gpio_open(gpio)) < 0) {
+    return 1;
+  }
+
+  switch (chip) {
+    case RawTime::CHIP_DS1307: {
+      DS1307 rtc(wire);
+      if (opt.gpio >= 0) {
+        enable_1hz(rtc);
+      }
+      return run(rtc, opt);
+    }
+    case RawTime::CHIP_DS3231: {
+      DS3231 rtc(wire);
+      if (opt.gpio >= 0) {
+        enable_1hz(rtc);
+      }
+      return run(rtc, opt);
+    }
+    case RawTime::CHIP_RX8025T: {
+      RX8025T rtc(wire);
+      if (opt.gpio >= 0) {
+        enable_1hz(rtc);
+      }
+      return run(rtc, opt);
+    }
+    case RawTime::CHIP_PCF8563: {
+      PCF8563 rtc(wire);
+      if (opt.gpio >= 0) {
+        enable_1hz(rtc);
+      }
+      return run(rtc, opt);
+    }
+    default:
+      return 1;
+  }
+}
@@ -0,0 +1,295 @@
+// Sets RTCs running TimeSyncServer (RTClib_sync.h) to the host clock, which
+// should itself be NTP-disciplined. Host only:
+//
+//   g++ -std=gnu++11 -O2 -Isrc -o rtc_timesync extras/timesync/rtc_timesync.cpp
+//       src/RTClib_linux.cpp
+//   ./rtc_timesync [-b baud] [-n pings] [-r readbacks] [-c] [-w] port...
+//
+// For each port: waits up to 5 s for the board to answer (many reset when
+// the port opens), takes the fastest of n PING round trips as the link delay,
+// reads the offset before, sets the clock aligned to a host second boundary
+// and reads the residual offset back r times. -c only reads the offset.
+// -w is for provisioning a stream of boards: it never exits, and handles each
+// port again whenever it disappears and comes back (board swapped).
+//
+// Progress goes to stderr; stdout gets one CSV line per board:
+//
+//   port,rtt_us,set_us,before_ms,after_ms
+//
+// Offsets are chip minus host, empty when the chip had no valid time.
+// Try it without hardware against extras/timesync/timesync_emulator.
+
+#include "RTClib.h"
+#include "RTClib_sync.h"
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace timesync;
+
+static const int64_t USEC = 1000000;
+static const int64_t Y2K_EPOCH = 946684800;
+
+static int64_t realtime_us() {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return int64_t(ts.tv_sec) * USEC + ts.tv_nsec / 1000;
+}
+
+static void sleep_until(int64_t target) {
+  // coarse sleep, then spin through the last 2 ms
+  int64_t wake = target - 2000;
+  if (wake > realtime_us()) {
+    timespec ts = {time_t(wake / USEC), long(wake % USEC) * 1000};
+    while (clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &ts, nullptr) != 0) {
+    }
+  }
+  while (realtime_us() < target) {
+  }
+}
+
+struct Link {
+  Stream &port;
+  // one-way delay, us
+  int64_t delay;
+
+  // Sends a frame and waits for its reply. t1 is taken just before the
+  // write, t4 when the reply is complete.
+  bool exchange(uint8_t cmd, const uint8_t *payload, uint8_t len, Frame *reply, int64_t *t1, int64_t *t4,
+                int timeout = 300) {
+    while (port.read() >= 0) {
+      // stale bytes from an earlier, timed out exchange
+    }
+
+    uint8_t buf[MAX_FRAME];
+    uint8_t n = encode(cmd, payload, len, buf);
+    *t1 = realtime_us();
+    port.write(buf, n);
+
+    Parser parser;
+    int64_t deadline = *t1 + int64_t(timeout) * 1000;
+    for (;;) {
+      int64_t left = (deadline - realtime_us()) / 1000;
+      pollfd pfd = {port.fd(), POLLIN, 0};
+      if (left <= 0 || poll(&pfd, 1, left) <= 0) {
+        return false;
+      }
+
+      int val;
+      while ((val = port.read()) >= 0) {
+        if (parser.feed(val)) {
+          *t4 = realtime_us();
+          *reply = parser.frame();
+          return reply->cmd == (cmd | REPLY);
+        }
+      }
+    }
+  }
+
+  // fastest round trip of n, device time excluded; sets delay
+  int64_t measure(uint8_t n) {
+    int64_t best = -1;
+    for (uint8_t i = 0; i < n; ++i) {
+      uint8_t ping[PING_LEN] = {};
+      put32(ping, i);
+      Frame reply;
+      int64_t t1, t4;
+      if (!exchange(CMD_PING, ping, sizeof(ping), &reply, &t1, &t4) || get32(reply.payload) != i) {
+        continue;
+      }
+      int64_t rtt = (t4 - t1) - uint32_t(get32(reply.payload + 8) - get32(reply.payload + 4));
+      if (best < 0 || rtt < best) {
+        best = rtt;
+      }
+    }
+    delay = best / 2;
+    return best;
+  }
+
+  // chip minus host at the next rollover, in us; false if the chip has no
+  // valid time or does not tick
+  bool offset(int64_t *out) {
+    uint8_t timeout[2] = {0xdc, 0x05}; // 1500 ms
+    Frame reply;
+    int64_t t1, t4;
+    if (!exchange(CMD_EDGE, timeout, sizeof(timeout), &reply, &t1, &t4, 2000)) {
+      return false;
+    }
+    uint32_t y2k = get32(reply.payload);
+    if (y2k == 0) {
+      return false;
+    }
+    int64_t edge = t4 - delay - get32(reply.payload + 4);
+    *out = (int64_t(y2k) + Y2K_EPOCH) * USEC - edge;
+    return true;
+  }
+
+  // SET with the fields of the host second starting at at, returns how long
+  // the device took to apply it, or -1
+  int64_t set(int64_t at) {
+    time_t secs = at / USEC;
+    tm t;
+    gmtime_r(&secs, &t);
+    uint8_t fields[SET_LEN] = {uint8_t(t.tm_sec),     uint8_t(t.tm_min),        uint8_t(t.tm_hour),
+                               uint8_t(t.tm_mday),    uint8_t(t.tm_mon + 1),    uint8_t(t.tm_year - 100),
+                               uint8_t(t.tm_wday)};
+
+    Frame reply;
+    int64_t t1, t4;
+    if (!exchange(CMD_SET, fields, sizeof(fields), &reply, &t1, &t4)) {
+      return -1;
+    }
+    return uint32_t(get32(reply.payload + 4) - get32(reply.payload));
+  }
+};
+
+static bool wait_ready(Link &link) {
+  int64_t until = realtime_us() + 5 * USEC;
+  while (realtime_us() < until) {
+    uint8_t ping[PING_LEN] = {};
+    Frame reply;
+    int64_t t1, t4;
+    if (link.exchange(CMD_PING, ping, sizeof(ping), &reply, &t1, &t4, 100)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void print_ms(bool ok, int64_t us) {
+  if (ok) {
+    printf("%.3f", us / 1000.0);
+  }
+}
+
+static bool provision(const char *path, uint32_t baud, uint8_t pings, uint8_t readbacks, bool check) {
+  Stream port(path, baud);
+  if (!port.isOpen()) {
+    perror(path);
+    return false;
+  }
+
+  Link link = {port, 0};
+  if (!wait_ready(link)) {
+    fprintf(stderr, "%s: no answer\n", path);
+    return false;
+  }
+
+  int64_t rtt = link.measure(pings);
+  if (rtt < 0) {
+    fprintf(stderr, "%s: no PING reply\n", path);
+    return false;
+  }
+  fprintf(stderr, "%s: rtt %lld us\n", path, (long long)rtt);
+
+  int64_t before = 0, after = 0, apply = 0;
+  bool haveBefore = link.offset(&before);
+  fprintf(stderr, "%s: offset before ", path);
+  if (haveBefore) {
+    fprintf(stderr, "%.3f ms\n", before / 1000.0);
+  } else {
+    fprintf(stderr, "unknown\n");
+  }
+
+  bool haveAfter = haveBefore;
+  after = before;
+  if (!check) {
+    // a first, plain SET measures how long the write takes and gets a
+    // stopped chip ticking for the readback
+    apply = link.set(realtime_us());
+    if (apply < 0) {
+      fprintf(stderr, "%s: SET failed\n", path);
+      return false;
+    }
+
+    int64_t lead = link.delay + apply;
+    int64_t at = (realtime_us() + lead + 200000) / USEC * USEC + USEC;
+    sleep_until(at - lead);
+    if (link.set(at) < 0) {
+      fprintf(stderr, "%s: SET failed\n", path);
+      return false;
+    }
+
+    // mean of the readbacks
+    int64_t sum = 0;
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < readbacks; ++i) {
+      int64_t off;
+      if (link.offset(&off)) {
+        fprintf(stderr, "%s: offset after %.3f ms\n", path, off / 1000.0);
+        sum += off;
+        ++n;
+      }
+    }
+    haveAfter = n > 0;
+    after = n > 0 ? sum / n : 0;
+  }
+
+  printf("%s,%lld,%lld,", path, (long long)rtt, (long long)apply);
+  print_ms(haveBefore, before);
+  printf(",");
+  print_ms(haveAfter, after);
+  printf("\n");
+  fflush(stdout);
+  return haveAfter;
+}
+
+int main(int argc, char **argv) {
+  uint32_t baud = 115200;
+  uint8_t pings = 16, readbacks = 3;
+  bool check = false, watch = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "b:n:r:cw")) != -1) {
+    switch (opt) {
+      case 'b':
+        baud = atoi(optarg);
+        break;
+      case 'n':
+        pings = atoi(optarg);
+        break;
+      case 'r':
+        readbacks = atoi(optarg);
+        break;
+      case 'c':
+        check = true;
+        break;
+      case 'w':
+        watch = true;
+        break;
+      default:
+        optind = argc + 1;
+        break;
+    }
+  }
+  if (optind >= argc) {
+    fprintf(stderr, "usage: %s [-b baud] [-n pings] [-r readbacks] [-c] [-w] port...\n", argv[0]);
+    return 2;
+  }
+
+  if (!watch) {
+    bool ok = true;
+    for (int i = optind; i < argc; ++i) {
+      ok &= provision(argv[i], baud, pings, readbacks, check);
+    }
+    return ok ? 0 : 1;
+  }
+
+  // bit per port: handled since it last appeared
+  uint64_t done = 0;
+  for (;;) {
+    for (int i = optind; i < argc && i - optind < 64; ++i) {
+      uint64_t bit = uint64_t(1) << (i - optind);
+      if (access(argv[i], F_OK) != 0) {
+        done &= ~bit;
+      } else if ((done & bit) == 0) {
+        provision(argv[i], baud, pings, readbacks, check);
+        done |= bit;
+      }
+    }
+    usleep(200000);
+  }
+}
@@ -0,0 +1,201 @@
+// A DS3231 behind TimeSyncServer on a pseudo-terminal, to run rtc_timesync
+// end to end without a board. Host only:
+//
+//   g++ -std=gnu++11 -O2 -Isrc -o timesync_emulator
+//       extras/timesync/timesync_emulator.cpp src/RTClib.cpp src/RTClib_linux.cpp
+//   ./timesync_emulator [-o offset_s] [-d drift_ppm] [-l latency_us] [-L link]
+//
+// Prints the pty to open (and symlinks it to link, if given). The emulated
+// chip starts offset_s off the host clock, runs drift_ppm fast and, like the
+// real one, restarts its divider when the seconds register is written.
+// latency_us delays both directions of the link, as a USB serial bridge
+// would.
+
+#include "RTClib.h"
+#include "RTClib_sync.h"
+
+#include <deque>
+#include <fcntl.h>
+#include <linux/i2c.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <utility>
+
+using __rtclib_details::bin2bcd;
+
+static uint8_t regs[0x13];
+
+// chip seconds since 2000 at base_mono, and how fast they run
+static double chip_base;
+static double base_mono;
+static double rate = 1.0;
+
+static double now_mono() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double now_real() {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void load_regs(double now) {
+  time_t secs = time_t(chip_base + (now - base_mono) * rate) + 946684800;
+  tm t;
+  gmtime_r(&secs, &t);
+
+  regs[0] = bin2bcd(t.tm_sec);
+  regs[1] = bin2bcd(t.tm_min);
+  regs[2] = bin2bcd(t.tm_hour);
+  regs[3] = t.tm_wday + 1;
+  regs[4] = bin2bcd(t.tm_mday);
+  regs[5] = bin2bcd(t.tm_mon + 1);
+  regs[6] = bin2bcd(t.tm_year - 100);
+}
+
+static int clock_transfer(void *ctx, int fd, i2c_msg *msgs, uint32_t nmsgs) {
+  double now = now_mono();
+  load_regs(now);
+
+  int ret = FakeI2CBus::transfer(ctx, fd, msgs, nmsgs);
+
+  for (uint32_t i = 0; i < nmsgs; ++i) {
+    if ((msgs[i].flags & I2C_M_RD) == 0 && msgs[i].len > 1 && msgs[i].buf[0] == 0x00) {
+      // seconds written: the divider restarts from here
+      RawTime raw;
+      memcpy(raw.regs, regs, sizeof(raw.regs));
+      raw.chip = RawTime::CHIP_DS3231;
+      chip_base = raw.toY2KSeconds();
+      base_mono = now;
+    }
+  }
+  return ret;
+}
+
+// Holds bytes back for the link latency in each direction
+class DelayedPort {
+public:
+  DelayedPort(Stream &stream, uint32_t latency) : _stream {stream}, _latency {latency} {}
+
+  void pump() {
+    int val;
+    while ((val = _stream.read()) >= 0) {
+      _in.push_back(std::make_pair(micros(), uint8_t(val)));
+    }
+    while (!_out.empty() && micros() - _out.front().first >= _latency) {
+      _stream.write(_out.front().second);
+      _out.pop_front();
+    }
+  }
+
+  int available() {
+    pump();
+    int n = 0;
+    for (auto &b : _in) {
+      if (micros() - b.first < _latency) {
+        break;
+      }
+      ++n;
+    }
+    return n;
+  }
+
+  int read() {
+    if (available() == 0) {
+      return -1;
+    }
+    uint8_t val = _in.front().second;
+    _in.pop_front();
+    return val;
+  }
+
+  size_t write(const uint8_t *buf, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+      _out.push_back(std::make_pair(micros(), buf[i]));
+    }
+    pump();
+    return len;
+  }
+
+private:
+  Stream &_stream;
+  uint32_t _latency;
+  std::deque<std::pair<uint32_t, uint8_t>> _in, _out;
+};
+
+int main(int argc, char **argv) {
+  double offset = 0, drift = 0;
+  uint32_t latency = 0;
+  const char *link = nullptr;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "o:d:l:L:")) != -1) {
+    switch (opt) {
+      case 'o':
+        offset = atof(optarg);
+        break;
+      case 'd':
+        drift = atof(optarg);
+        break;
+      case 'l':
+        latency = atoi(optarg);
+        break;
+      case 'L':
+        link = optarg;
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-o offset_s] [-d drift_ppm] [-l latency_us] [-L link]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+    perror("posix_openpt");
+    return 1;
+  }
+  const char *path = ptsname(master);
+
+  // keep the slave open and raw, so nothing is echoed before a client
+  // configures it, and the master never sees a hangup between clients
+  int slave = open(path, O_RDWR | O_NOCTTY);
+  termios tio;
+  tcgetattr(slave, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(slave, TCSANOW, &tio);
+
+  if (link != nullptr) {
+    unlink(link);
+    if (symlink(path, link) != 0) {
+      perror("symlink");
+      return 1;
+    }
+  }
+  printf("%s\n", path);
+  fflush(stdout);
+
+  base_mono = now_mono();
+  chip_base = now_real() - 946684800 + offset;
+  rate = 1 + drift * 1e-6;
+
+  FakeI2CBus bus;
+  bus.attach(0x68, regs, sizeof(regs));
+  TwoWire wire(clock_transfer, &bus);
+  DS3231 rtc(wire);
+
+  Stream stream(master);
+  DelayedPort port(stream, latency);
+  TimeSyncServer<DS3231, DelayedPort> server(rtc, port);
+
+  for (;;) {
+    port.pump();
+    server.poll();
+    usleep(20);
+  }
+}
@@ -1,5 +1,7 @@
 #include "RTClib.h"
 
+#include <string.h>
+
 namespace __rtclib_details {
   // RAII class for data transferring to/from DS1302
   class TransferHelper {
@@ -123,15 +125,81 @@ namespace __rtclib_details {
 
 using namespace __rtclib_details;
 
-static constexpr uint8_t bcd2bin(uint8_t val) {
-  return val - 6 * (val >> 4);
+static constexpr bool is_leap(uint16_t year) {
+  return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+// days from 2000-01-01, valid for 2000..2199; 32 bits, the count passes
+// 65535 in 2179
+static uint32_t days_since_2000(uint16_t year, uint8_t mon, uint8_t mday) {
+  uint32_t y = year - 2000;
+  uint32_t days = y * 365 + (y + 3) / 4 - (y + 99) / 100 + (y + 399) / 400;
+  // days before month, the 367/12 trick is exact up to the February fixup
+  days += (367 * mon - 362) / 12;
+  if (mon > 2) {
+    days -= is_leap(year) ? 1 : 2;
+  }
+  return days + mday - 1;
+}
+
+void RawTime::toTm(tm *timeptr) const {
+  timeptr->tm_sec = second();
+  timeptr->tm_min = minute();
+  timeptr->tm_hour = hour();
+  timeptr->tm_mday = mday();
+  timeptr->tm_mon = month() - 1;
+  timeptr->tm_year = year() - 1900;
+  timeptr->tm_wday = wday();
+}
+
+uint32_t RawTime::toY2KSeconds() const {
+  uint32_t days = days_since_2000(year(), month(), mday());
+  return days * 86400UL + hour() * 3600UL + minute() * 60U + second();
+}
+
+time_t RawTime::toEpoch() const {
+  // not via toY2KSeconds(), a 64-bit time_t reaches past 2136
+  time_t days = days_since_2000(year(), month(), mday());
+  return y2k_epoch + days * 86400 + hour() * 3600UL + minute() * 60U + second();
+}
+
+static bool bcd_in_range(uint8_t val, uint8_t lo, uint8_t hi) {
+  return (val & 0x0f) <= 9 && (val >> 4) <= 9 && val >= lo && val <= hi;
+}
+
+bool RawTime::isPlausible() const {
+  return bcd_in_range(regs[0] & 0x7f, 0x00, 0x59) && bcd_in_range(regs[1] & 0x7f, 0x00, 0x59) &&
+         bcd_in_range(regs[2] & 0x3f, 0x00, 0x23) && bcd_in_range(regs[_mdayIdx()] & 0x3f, 0x01, 0x31) &&
+         bcd_in_range(regs[_monIdx()] & 0x1f, 0x01, 0x12) && bcd_in_range(regs[6], 0x00, 0x99);
+}
+
+// status for getRawTimeChecked(), stopped and lost being the chip's flags
+static TimeStatus checked_status(const RawTime &raw, bool stopped, bool lost) {
+  if (!raw.isPlausible()) {
+    return TIME_INVALID;
+  }
+  return stopped ? TIME_STOPPED : lost ? TIME_LOST : TIME_OK;
+}
+
+void PackedTime::toTm(tm *timeptr) const {
+  timeptr->tm_sec = second();
+  timeptr->tm_min = minute();
+  timeptr->tm_hour = hour();
+  timeptr->tm_mday = mday();
+  timeptr->tm_mon = month() - 1;
+  timeptr->tm_year = year() - 1900;
+  // 2000-01-01 was a Saturday
+  timeptr->tm_wday = (days_since_2000(year(), month(), mday()) + 6) % 7;
 }
 
-static constexpr uint8_t bin2bcd(uint8_t val) {
-  return val + 6 * (val / 10);
+uint32_t PackedTime::toY2KSeconds() const {
+  uint32_t days = days_since_2000(year(), month(), mday());
+  return days * 86400UL + hour() * 3600UL + minute() * 60U + second();
 }
 
 static void i2c_rtc_write(TwoWire &wire, uint8_t dev, uint8_t addr, uint8_t val) {
+  BusLock _lock;
+
   wire.beginTransmission(dev);
   wire.write(addr);
   wire.write(val);
@@ -139,16 +207,273 @@ static void i2c_rtc_write(TwoWire &wire, uint8_t dev, uint8_t addr, uint8_t val)
 }
 
 static uint8_t i2c_rtc_read(TwoWire &wire, uint8_t dev, uint8_t addr) {
+  BusLock _lock;
+
   wire.beginTransmission(dev);
   wire.write(addr);
-  wire.endTransmission();
+  wire.endTransmission(false);
 
   wire.requestFrom(dev, uint8_t(1));
   return wire.read();
 }
 
+namespace __rtclib_details {
+  uint8_t i2c_get_bits(TwoWire &wire, uint8_t dev, uint16_t field) {
+    return i2c_rtc_read(wire, dev, field >> 8) & field;
+  }
+
+  void i2c_set_bits(TwoWire &wire, uint8_t dev, uint16_t field, uint8_t val) {
+    BusLock _lock;
+
+    uint8_t reg = field >> 8;
+    uint8_t mask = field;
+    uint8_t regval = i2c_rtc_read(wire, dev, reg);
+    if ((regval & mask) != (val & mask)) {
+      i2c_rtc_write(wire, dev, reg, (regval & ~mask) | (val & mask));
+    }
+  }
+} // namespace __rtclib_details
+
+static void i2c_rtc_read_burst(TwoWire &wire, uint8_t dev, uint8_t addr, uint8_t *buf, uint8_t len) {
+  BusLock _lock;
+
+  wire.beginTransmission(dev);
+  wire.write(addr);
+  wire.endTransmission(false);
+
+  wire.requestFrom(dev, len);
+  for (uint8_t i = 0; i < len; ++i) {
+    buf[i] = wire.read();
+  }
+}
+
+namespace __rtclib_details {
+  // Register transaction builder for the I2C chips. Reads and writes are
+  // queued first and issued by run() as few bus transactions as possible:
+  // back-to-back requests of the same direction are sorted by address and
+  // adjacent or overlapping ranges are merged into one auto-increment burst.
+  // Reads are issued as address write + repeated start + read.
+  class RegTransaction {
+  public:
+    static constexpr uint8_t MAX_OPS = 8;
+    static constexpr uint8_t MAX_BURST = 30; // fits the 32-byte Wire buffer
+
+  private:
+    struct Op {
+      uint8_t addr;
+      uint8_t len;
+      bool write;
+      union {
+        uint8_t *dst;  // read destination
+        uint8_t wpos;  // offset into _wdata
+      };
+    };
+
+    TwoWire &_wire;
+    uint8_t _dev;
+    Op _ops[MAX_OPS];
+    uint8_t _nops;
+    uint8_t _wdata[MAX_BURST];
+    uint8_t _wlen;
+    uint8_t _transactions;
+    bool _ok;
+
+    bool _push(uint8_t addr, uint8_t len, bool write) {
+      if (_nops == MAX_OPS || len == 0 || len > MAX_BURST) {
+        _ok = false;
+        return false;
+      }
+      _ops[_nops].addr = addr;
+      _ops[_nops].len = len;
+      _ops[_nops].write = write;
+      return true;
+    }
+
+    // sorts _ops[from, to) by address, insertion sort is plenty for MAX_OPS
+    void _sort(uint8_t from, uint8_t to) {
+      for (uint8_t i = from + 1; i < to; ++i) {
+        Op op = _ops[i];
+        uint8_t j = i;
+        for (; j > from && _ops[j - 1].addr > op.addr; --j) {
+          _ops[j] = _ops[j - 1];
+        }
+        _ops[j] = op;
+      }
+    }
+
+    void _burstRead(uint8_t from, uint8_t to, uint8_t addr, uint8_t len) {
+      uint8_t buf[MAX_BURST];
+
+      _wire.beginTransmission(_dev);
+      _wire.write(addr);
+      _ok &= _wire.endTransmission(false) == 0;
+      _ok &= _wire.requestFrom(_dev, len) == len;
+      for (uint8_t i = 0; i < len; ++i) {
+        buf[i] = _wire.read();
+      }
+      ++_transactions;
+
+      for (uint8_t i = from; i < to; ++i) {
+        memcpy(_ops[i].dst, buf + (_ops[i].addr - addr), _ops[i].len);
+      }
+    }
+
+    void _burstWrite(uint8_t from, uint8_t to, uint8_t addr, uint8_t len) {
+      uint8_t buf[MAX_BURST];
+
+      // replay in queue order (ascending wpos) so the last write to a
+      // register wins when ranges overlap
+      for (uint8_t n = from, prev = 0; n < to; ++n) {
+        uint8_t pick = to;
+        for (uint8_t i = from; i < to; ++i) {
+          if ((n == from || _ops[i].wpos > prev) && (pick == to || _ops[i].wpos < _ops[pick].wpos)) {
+            pick = i;
+          }
+        }
+        memcpy(buf + (_ops[pick].addr - addr), _wdata + _ops[pick].wpos, _ops[pick].len);
+        prev = _ops[pick].wpos;
+      }
+
+      _wire.beginTransmission(_dev);
+      _wire.write(addr);
+      _wire.write(buf, len);
+      _ok &= _wire.endTransmission() == 0;
+      ++_transactions;
+    }
+
+  public:
+    RegTransaction(TwoWire &wire, uint8_t dev)
+        : _wire {wire}, _dev {dev}, _nops {0}, _wlen {0}, _transactions {0}, _ok {true} {}
+
+    RegTransaction &read(uint8_t addr, uint8_t *dst, uint8_t len = 1) {
+      if (_push(addr, len, false)) {
+        _ops[_nops++].dst = dst;
+      }
+      return *this;
+    }
+
+    RegTransaction &write(uint8_t addr, const uint8_t *src, uint8_t len) {
+      if (_wlen + len > MAX_BURST) {
+        _ok = false;
+      } else if (_push(addr, len, true)) {
+        memcpy(_wdata + _wlen, src, len);
+        _ops[_nops++].wpos = _wlen;
+        _wlen += len;
+      }
+      return *this;
+    }
+
+    RegTransaction &write(uint8_t addr, uint8_t val) { return write(addr, &val, 1); }
+
+    // number of bus transactions issued so far
+    uint8_t transactions() const { return _transactions; }
+
+    // Executes and clears the queue, returns false if any transfer failed
+    // or the queue overflowed. The builder can be reused afterwards, which
+    // is how read-modify-write sequences are done.
+    bool run() {
+      BusLock _lock;
+
+      uint8_t phase = 0;
+      while (phase < _nops) {
+        bool write = _ops[phase].write;
+        uint8_t end = phase + 1;
+        while (end < _nops && _ops[end].write == write) {
+          ++end;
+        }
+
+        _sort(phase, end);
+
+        uint8_t first = phase;
+        uint8_t lo = _ops[phase].addr;
+        uint8_t hi = lo + _ops[phase].len;
+        for (uint8_t i = phase + 1; i <= end; ++i) {
+          if (i < end && _ops[i].addr <= hi && _ops[i].addr + _ops[i].len - lo <= MAX_BURST) {
+            if (_ops[i].addr + _ops[i].len > hi) {
+              hi = _ops[i].addr + _ops[i].len;
+            }
+            continue;
+          }
+
+          if (write) {
+            _burstWrite(first, i, lo, hi - lo);
+          } else {
+            _burstRead(first, i, lo, hi - lo);
+          }
+
+          if (i < end) {
+            first = i;
+            lo = _ops[i].addr;
+            hi = lo + _ops[i].len;
+          }
+        }
+
+        phase = end;
+      }
+
+      bool ok = _ok;
+      _nops = 0;
+      _wlen = 0;
+      _ok = true;
+      return ok;
+    }
+  };
+} // namespace __rtclib_details
+
+// Brings registers [base, base + len) in line with `image`, len <= 16.
+// Bits cleared in `mask` are don't-care when comparing. Registers flagged in
+// `force` are written regardless, all others only if they differ from what
+// the chip holds. The current block is fetched with one burst read, then
+// each run of differing registers goes out as one burst write; runs are
+// joined across gaps of up to two `stable` registers, rewritten with their
+// read-back value, since that is cheaper than another transaction.
+static bool i2c_rtc_sync_block(TwoWire &wire, uint8_t dev, uint8_t base, const uint8_t *image,
+                               const uint8_t *mask, uint8_t len, uint16_t force, uint16_t stable) {
+  static constexpr uint8_t max_gap = 2;
+
+  BusLock _lock;
+  RegTransaction tr(wire, dev);
+  uint8_t cur[16];
+  uint16_t dirty = force;
+
+  if (!tr.read(base, cur, len).run()) {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < len; ++i) {
+    if ((cur[i] ^ image[i]) & mask[i]) {
+      dirty |= 1U << i;
+    }
+  }
+
+  for (uint8_t i = 0; i < len; ++i) {
+    if ((dirty & (1U << i)) == 0) {
+      continue;
+    }
+
+    uint8_t end = i + 1;
+    for (uint8_t j = end; j < len && j - end <= max_gap; ++j) {
+      if (dirty & (1U << j)) {
+        end = j + 1;
+      } else if ((stable & (1U << j)) == 0) {
+        break;
+      }
+    }
+
+    uint8_t buf[16];
+    for (uint8_t j = i; j < end; ++j) {
+      buf[j - i] = (dirty & (1U << j)) ? image[j] : cur[j];
+    }
+    tr.write(base + i, buf, end - i);
+    i = end;
+  }
+
+  return tr.run();
+}
+
 #define MASK_BOOL_REG_BITS(reg, maskbits, boolval)  \
   do {                                              \
+    BusLock _lock;                                  \
     uint8_t mask = (boolval) ? (maskbits) : 0;      \
     uint8_t regval = readReg(reg);                  \
     if ((regval & (maskbits)) != mask) {            \
@@ -161,8 +486,25 @@ DS1302::DS1302(uint8_t ce, uint8_t sck, uint8_t io) : _ce {ce}, _sck {sck}, _io
 bool DS1302::setup() {
   pinMode(_ce, OUTPUT);
   pinMode(_sck, OUTPUT);
-  writeReg(DS1302_W_WP, 0);
-  setRunning(true);
+
+  // the clock burst ends with the WP register, so one read covers CH and WP
+  uint8_t regs[8];
+  {
+    TransferHelper _tr(_ce, _sck);
+
+    _write(DS1302_R_CLKBURST);
+    for (uint8_t i = 0; i < sizeof(regs); ++i) {
+      regs[i] = _read();
+    }
+  }
+
+  if (regs[7] & 0x80) {
+    writeReg(DS1302_W_WP, 0);
+  }
+  if (regs[0] & 0x80) {
+    // CH set, clock halted
+    writeReg(DS1302_W_SEC, regs[0] & 0x7f);
+  }
 
   return true;
 }
@@ -249,12 +591,42 @@ void DS1302::setTime(const tm *timeptr) {
   _write(0);
 }
 
+RawTime DS1302::getRawTime() {
+  TransferHelper _tr(_ce, _sck);
+
+  RawTime raw;
+  raw.chip = RawTime::CHIP_DS1302;
+
+  _write(DS1302_R_CLKBURST);
+  for (uint8_t i = 0; i < sizeof(raw.regs); ++i) {
+    raw.regs[i] = _read();
+  }
+  return raw;
+}
+
+TimeStatus DS1302::getTimeChecked(tm *timeptr) {
+  RawTime raw;
+  TimeStatus status = getRawTimeChecked(&raw);
+  raw.toTm(timeptr);
+  return status;
+}
+
+TimeStatus DS1302::getRawTimeChecked(RawTime *raw) {
+  *raw = getRawTime();
+  // CH
+  return checked_status(*raw, raw->regs[0] & 0x80, false);
+}
+
 bool DS1302::isRunning() {
   return (readReg(DS1302_R_SEC) & 0x80) == 0;
 }
 
 void DS1302::setRunning(bool running) {
-  MASK_BOOL_REG_BITS(DS1302_R_SEC, 0x80, !running);
+  // reads and writes have different addresses here, so no MASK_BOOL_REG_BITS
+  uint8_t sec = readReg(DS1302_R_SEC);
+  if (((sec & 0x80) == 0) != running) {
+    writeReg(DS1302_W_SEC, running ? sec & 0x7f : sec | 0x80);
+  }
 }
 
 DS1302::TrickleChargerMode DS1302::getTrickleCharger() {
@@ -293,9 +665,62 @@ void DS1302::writeRAM(uint8_t index, uint8_t val) {
   _write(val);
 }
 
+void DS1302::readRAM(uint8_t index, uint8_t *buf, uint8_t len) {
+  if (index >= RAM_SIZE) {
+    return;
+  }
+  if (len > RAM_SIZE - index) {
+    len = RAM_SIZE - index;
+  }
+
+  TransferHelper _tr(_ce, _sck);
+
+  // a RAM burst always starts at index 0
+  _write(DS1302_R_RAMBURST);
+  for (uint8_t i = 0; i < index + len; ++i) {
+    uint8_t val = _read();
+    if (i >= index) {
+      buf[i - index] = val;
+    }
+  }
+}
+
+void DS1302::writeRAM(uint8_t index, const uint8_t *buf, uint8_t len) {
+  if (index >= RAM_SIZE) {
+    return;
+  }
+  if (len > RAM_SIZE - index) {
+    len = RAM_SIZE - index;
+  }
+
+  if (index != 0 && len == 1) {
+    writeRAM(index, *buf);
+    return;
+  }
+
+  // a RAM burst always starts at index 0, so the bytes before the span are
+  // read first and written back unchanged: two transfers instead of len
+  uint8_t head[RAM_SIZE];
+  if (index != 0) {
+    readRAM(0, head, index);
+  }
+
+  TransferHelper _tr(_ce, _sck);
+
+  _write(DS1302_W_RAMBURST);
+  for (uint8_t i = 0; i < index; ++i) {
+    _write(head[i]);
+  }
+  for (uint8_t i = 0; i < len; ++i) {
+    _write(buf[i]);
+  }
+}
+
 DS1307::DS1307(TwoWire &wire) : _wire {wire} {}
 
 bool DS1307::setup() {
+  BusLock _lock;
+
   _wire.beginTransmission(ADDRESS);
   return _wire.endTransmission() == 0;
 }
@@ -324,10 +749,54 @@ void DS1307::writeRAM(uint8_t index, uint8_t val) {
   i2c_rtc_write(_wire, ADDRESS, DS1307_RAM + index, val);
 }
 
+void DS1307::readRAM(uint8_t index, uint8_t *buf, uint8_t len) {
+  if (index >= RAM_SIZE) {
+    return;
+  }
+  if (len > RAM_SIZE - index) {
+    len = RAM_SIZE - index;
+  }
+
+  // in pieces that fit the Wire buffer
+  while (len) {
+    uint8_t n = len;
+    if (n > RegTransaction::MAX_BURST) {
+      n = RegTransaction::MAX_BURST;
+    }
+    i2c_rtc_read_burst(_wire, ADDRESS, DS1307_RAM + index, buf, n);
+    index += n;
+    buf += n;
+    len -= n;
+  }
+}
+
+void DS1307::writeRAM(uint8_t index, const uint8_t *buf, uint8_t len) {
+  if (index >= RAM_SIZE) {
+    return;
+  }
+  if (len > RAM_SIZE - index) {
+    len = RAM_SIZE - index;
+  }
+
+  RegTransaction tr(_wire, ADDRESS);
+  while (len) {
+    uint8_t n = len;
+    if (n > RegTransaction::MAX_BURST) {
+      n = RegTransaction::MAX_BURST;
+    }
+    tr.write(DS1307_RAM + index, buf, n).run();
+    index += n;
+    buf += n;
+    len -= n;
+  }
+}
+
 void DS1307::getTime(tm *timeptr) {
+  BusLock _lock;
+
   _wire.beginTransmission(ADDRESS);
   _wire.write(DS1307_SEC);
-  _wire.endTransmission();
+  _wire.endTransmission(false);
 
   _wire.requestFrom(ADDRESS, uint8_t(7));
   timeptr->tm_sec = bcd2bin(_wire.read() & 0x7f);
@@ -345,6 +814,8 @@ void DS1307::getTime(tm *timeptr) {
 }
 
 void DS1307::setTime(const tm *timeptr) {
+  BusLock _lock;
+
   uint8_t wday = timeptr->tm_wday;
   if (wday == 0) {
     // Sunday
@@ -363,12 +834,24 @@ void DS1307::setTime(const tm *timeptr) {
   _wire.endTransmission();
 }
 
-bool DS1307::isRunning() {
-  return (readReg(DS1307_SEC) & 0x80) == 0;
+RawTime DS1307::getRawTime() {
+  RawTime raw;
+  raw.chip = RawTime::CHIP_DS1307;
+  i2c_rtc_read_burst(_wire, ADDRESS, DS1307_SEC, raw.regs, sizeof(raw.regs));
+  return raw;
 }
 
-void DS1307::setRunning(bool running) {
-  MASK_BOOL_REG_BITS(DS1307_SEC, 0x80, !running);
+TimeStatus DS1307::getTimeChecked(tm *timeptr) {
+  RawTime raw;
+  TimeStatus status = getRawTimeChecked(&raw);
+  raw.toTm(timeptr);
+  return status;
+}
+
+TimeStatus DS1307::getRawTimeChecked(RawTime *raw) {
+  *raw = getRawTime();
+  // CH
+  return checked_status(*raw, raw->regs[0] & 0x80, false);
 }
 
 DS1307::SqWaveFreq DS1307::getSQWOut() {
@@ -389,6 +872,8 @@ void DS1307::setSQWOut(SqWaveFreq value) {
 DS3231::DS3231(TwoWire &wire) : _wire {wire} {}
 
 bool DS3231::setup() {
+  BusLock _lock;
+
   _wire.beginTransmission(ADDRESS);
   return _wire.endTransmission() == 0;
 }
@@ -402,9 +887,11 @@ void DS3231::writeReg(uint8_t addr, uint8_t val) {
 }
 
 void DS3231::getTime(tm *timeptr) {
+  BusLock _lock;
+
   _wire.beginTransmission(ADDRESS);
   _wire.write(DS3231_SEC);
-  _wire.endTransmission();
+  _wire.endTransmission(false);
 
   _wire.requestFrom(ADDRESS, uint8_t(7));
   timeptr->tm_sec = bcd2bin(_wire.read() & 0x7f);
@@ -427,7 +914,8 @@ void DS3231::getTime(tm *timeptr) {
   }
 }
 
-void DS3231::setTime(const tm *timeptr) {
+// encodes time into SEC..YEAR
+static void ds3231_encode_time(const tm *timeptr, uint8_t *regs) {
   uint8_t wday = timeptr->tm_wday;
   if (wday == 0) {
     // Sunday
@@ -442,95 +930,93 @@ void DS3231::setTime(const tm *timeptr) {
     year -= 100;
   }
 
-  _wire.beginTransmission(ADDRESS);
-  _wire.write(DS3231_SEC);
-  _wire.write(bin2bcd(timeptr->tm_sec));
-  _wire.write(bin2bcd(timeptr->tm_min));
-  _wire.write(bin2bcd(timeptr->tm_hour));
-  _wire.write(wday);
-  _wire.write(bin2bcd(timeptr->tm_mday));
-  _wire.write(cen_mon);
-  _wire.write(bin2bcd(year));
-  _wire.endTransmission();
-}
-
-bool DS3231::isRunning() {
-  return (readReg(DS3231_CTRL) & 0x80) == 0;
-}
-
-void DS3231::setRunning(bool running) {
-  MASK_BOOL_REG_BITS(DS3231_SEC, 0x80, !running);
-}
-
-bool DS3231::getINTCN() {
-  return (readReg(DS3231_CTRL) & 0x04) != 0;
-}
-
-void DS3231::setINTCN(bool intcn) {
-  MASK_BOOL_REG_BITS(DS3231_CTRL, 0x04, intcn);
+  regs[0] = bin2bcd(timeptr->tm_sec);
+  regs[1] = bin2bcd(timeptr->tm_min);
+  regs[2] = bin2bcd(timeptr->tm_hour);
+  regs[3] = wday;
+  regs[4] = bin2bcd(timeptr->tm_mday);
+  regs[5] = cen_mon;
+  regs[6] = bin2bcd(year);
 }
 
-bool DS3231::getBBSQW() {
-  return (readReg(DS3231_CTRL) & 0x40) != 0;
-}
-
-void DS3231::setBBSQW(bool bbsqw) {
-  MASK_BOOL_REG_BITS(DS3231_CTRL, 0x40, bbsqw);
-}
-
-DS3231::SqWaveFreq DS3231::getSQWFreq() {
-  return static_cast<SqWaveFreq>(readReg(DS3231_CTRL) & 0x18);
-}
+void DS3231::setTime(const tm *timeptr) {
+  BusLock _lock;
 
-void DS3231::setSQWFreq(SqWaveFreq freq) {
-  uint8_t ctrl = readReg(DS3231_CTRL);
-  writeReg(DS3231_CTRL, (ctrl & 0xe7) | freq);
-}
+  uint8_t regs[7];
+  ds3231_encode_time(timeptr, regs);
 
-bool DS3231::isIntrEnabled() {
-  return (readReg(DS3231_CTRL) & 0x04) != 0;
+  _wire.beginTransmission(ADDRESS);
+  _wire.write(DS3231_SEC);
+  _wire.write(regs, sizeof(regs));
+  _wire.endTransmission();
 }
 
-void DS3231::setIntrEnabled(bool enabled) {
-  MASK_BOOL_REG_BITS(DS3231_CTRL, 0x04, enabled);
+RawTime DS3231::getRawTime() {
+  RawTime raw;
+  raw.chip = RawTime::CHIP_DS3231;
+  i2c_rtc_read_burst(_wire, ADDRESS, DS3231_SEC, raw.regs, sizeof(raw.regs));
+  return raw;
 }
 
-bool DS3231::isAL1IntrEnabled() {
-  return (readReg(DS3231_CTRL) & 0x01) != 0;
+TimeStatus DS3231::getTimeChecked(tm *timeptr) {
+  RawTime raw;
+  TimeStatus status = getRawTimeChecked(&raw);
+  raw.toTm(timeptr);
+  return status;
 }
 
-void DS3231::setAL1IntrEnabled(bool enabled) {
-  MASK_BOOL_REG_BITS(DS3231_CTRL, 0x01, enabled);
-}
+TimeStatus DS3231::getRawTimeChecked(RawTime *raw) {
+  // STATUS, AGING, TEMP_MSB, TEMP_LSB, SEC..YEAR; the address wraps after
+  // TEMP_LSB
+  uint8_t regs[11];
+  i2c_rtc_read_burst(_wire, ADDRESS, DS3231_STATUS, regs, sizeof(regs));
 
-bool DS3231::getAL1IntrFlag() {
-  return (readReg(DS3231_STATUS) & 0x01) != 0;
+  raw->chip = RawTime::CHIP_DS3231;
+  memcpy(raw->regs, regs + 4, sizeof(raw->regs));
+  // OSF
+  return checked_status(*raw, false, regs[0] & 0x80);
 }
 
-void DS3231::clearAL1IntrFlag() {
-  MASK_BOOL_REG_BITS(DS3231_STATUS, 0x01, 0);
-}
+void DS3231::set32kHzOut(bool enabled) {
+  BusLock _lock;
 
-bool DS3231::isAL2IntrEnabled() {
-  return (readReg(DS3231_CTRL) & 0x02) != 0;
+  uint8_t status = readReg(DS3231_STATUS);
+  if (((status & 0x08) != 0) == enabled) {
+    return;
+  }
+  // OSF, A2F and A1F only clear on 0, write them as 1 to keep them intact
+  writeReg(DS3231_STATUS, (status & ~0x08) | 0x83 | (enabled ? 0x08 : 0));
 }
 
-void DS3231::setAL2IntrEnabled(bool enabled) {
-  MASK_BOOL_REG_BITS(DS3231_CTRL, 0x02, enabled);
-}
+uint8_t DS3231::serviceInterrupts(const IntrHandlers &handlers) {
+  uint8_t flags, handled;
+  {
+    BusLock _lock;
 
-bool DS3231::getAL2IntrFlag() {
-  return (readReg(DS3231_STATUS) & 0x02) != 0;
-}
+    uint8_t status = readReg(DS3231_STATUS);
+    flags = status & (INTR_AL1 | INTR_AL2);
+    handled = flags & ((handlers.alarm1 ? INTR_AL1 : 0) | (handlers.alarm2 ? INTR_AL2 : 0));
+    if (handled) {
+      // writing 1 leaves OSF/A2F/A1F as they are, 0 clears
+      writeReg(DS3231_STATUS, (status | 0x83) & ~handled);
+    }
+  }
 
-void DS3231::clearAL2IntrFlag() {
-  MASK_BOOL_REG_BITS(DS3231_STATUS, 0x02, 0);
+  if (handled & INTR_AL1) {
+    handlers.alarm1(handlers.ctx);
+  }
+  if (handled & INTR_AL2) {
+    handlers.alarm2(handlers.ctx);
+  }
+  return flags;
 }
 
 DS3231::Alarm1Rate DS3231::getAL1(tm *timeptr) {
+  BusLock _lock;
+
   _wire.beginTransmission(ADDRESS);
   _wire.write(DS3231_AL1_SEC);
-  _wire.endTransmission();
+  _wire.endTransmission(false);
 
   _wire.requestFrom(ADDRESS, uint8_t(4));
   uint8_t sec = _wire.read();
@@ -580,7 +1066,8 @@ DS3231::Alarm1Rate DS3231::getAL1(tm *timeptr) {
   }
 }
 
-void DS3231::setAL1(Alarm1Rate rate, const tm *timeptr) {
+// encodes alarm 1 into AL1_SEC..AL1_DATE
+static void ds3231_encode_al1(DS3231::Alarm1Rate rate, const tm *timeptr, uint8_t *regs) {
   uint8_t sec = bin2bcd(timeptr->tm_sec);
   uint8_t min = bin2bcd(timeptr->tm_min);
   uint8_t hr = bin2bcd(timeptr->tm_hour);
@@ -592,38 +1079,49 @@ void DS3231::setAL1(Alarm1Rate rate, const tm *timeptr) {
   }
 
   switch (rate) {
-    case AL1_EVERY_SECOND:
+    case DS3231::AL1_EVERY_SECOND:
       sec |= 0x80;
       [[fallthrough]];
-    case AL1_MATCH_SECONDS:
+    case DS3231::AL1_MATCH_SECONDS:
       min |= 0x80;
       [[fallthrough]];
-    case AL1_MATCH_MINUTES:
+    case DS3231::AL1_MATCH_MINUTES:
       hr |= 0x80;
       [[fallthrough]];
-    case AL1_MATCH_HOURS:
+    case DS3231::AL1_MATCH_HOURS:
       date |= 0x80;
       [[fallthrough]];
     default:
       break;
-    case AL1_MATCH_DAY:
+    case DS3231::AL1_MATCH_DAY:
       date |= 0x40;
       break;
   }
 
+  regs[0] = sec;
+  regs[1] = min;
+  regs[2] = hr;
+  regs[3] = date;
+}
+
+void DS3231::setAL1(Alarm1Rate rate, const tm *timeptr) {
+  BusLock _lock;
+
+  uint8_t regs[4];
+  ds3231_encode_al1(rate, timeptr, regs);
+
   _wire.beginTransmission(ADDRESS);
   _wire.write(DS3231_AL1_SEC);
-  _wire.write(sec);
-  _wire.write(min);
-  _wire.write(hr);
-  _wire.write(date);
+  _wire.write(regs, sizeof(regs));
   _wire.endTransmission();
 }
 
 DS3231::Alarm2Rate DS3231::getAL2(tm *timeptr) {
+  BusLock _lock;
+
   _wire.beginTransmission(ADDRESS);
   _wire.write(DS3231_AL2_MIN);
-  _wire.endTransmission();
+  _wire.endTransmission(false);
 
   _wire.requestFrom(ADDRESS, uint8_t(3));
   uint8_t min = _wire.read();
@@ -668,7 +1166,8 @@ DS3231::Alarm2Rate DS3231::getAL2(tm *timeptr) {
   }
 }
 
-void DS3231::setAL2(Alarm2Rate rate, const tm *timeptr) {
+// encodes alarm 2 into AL2_MIN..AL2_DATE
+static void ds3231_encode_al2(DS3231::Alarm2Rate rate, const tm *timeptr, uint8_t *regs) {
   uint8_t min = bin2bcd(timeptr->tm_min);
   uint8_t hr = bin2bcd(timeptr->tm_hour);
   uint8_t date = bin2bcd(timeptr->tm_mday);
@@ -679,30 +1178,103 @@ void DS3231::setAL2(Alarm2Rate rate, const tm *timeptr) {
   }
 
   switch (rate) {
-    case AL2_EVERY_MINUTE:
+    case DS3231::AL2_EVERY_MINUTE:
       min |= 0x80;
       [[fallthrough]];
-    case AL2_MATCH_MINUTES:
+    case DS3231::AL2_MATCH_MINUTES:
       hr |= 0x80;
       [[fallthrough]];
-    case AL2_MATCH_HOURS:
+    case DS3231::AL2_MATCH_HOURS:
       date |= 0x80;
       [[fallthrough]];
     default:
       break;
-    case AL2_MATCH_DAY:
+    case DS3231::AL2_MATCH_DAY:
       date |= 0x40;
       break;
   }
 
+  regs[0] = min;
+  regs[1] = hr;
+  regs[2] = date;
+}
+
+void DS3231::setAL2(Alarm2Rate rate, const tm *timeptr) {
+  BusLock _lock;
+
+  uint8_t regs[3];
+  ds3231_encode_al2(rate, timeptr, regs);
+
   _wire.beginTransmission(ADDRESS);
   _wire.write(DS3231_AL2_MIN);
-  _wire.write(min);
-  _wire.write(hr);
-  _wire.write(date);
+  _wire.write(regs, sizeof(regs));
   _wire.endTransmission();
 }
 
+void DS3231::setAlarms(Alarm1Rate rate1, const tm *al1, Alarm2Rate rate2, const tm *al2) {
+  BusLock _lock;
+
+  RegTransaction tr(_wire, ADDRESS);
+
+  // a failed read leaves ctrl undefined, and writing it back could stop the
+  // oscillator (EOSC) or start a conversion
+  uint8_t ctrl;
+  if (!tr.read(DS3231_CTRL, &ctrl).run()) {
+    return;
+  }
+
+  // INTCN routes the alarms to the INT/SQW pin
+  ctrl = (ctrl & ~0x03) | 0x04;
+
+  if (rate1 != AL1_INVALID) {
+    uint8_t regs[4];
+    ds3231_encode_al1(rate1, al1, regs);
+    tr.write(DS3231_AL1_SEC, regs, sizeof(regs));
+    ctrl |= 0x01;
+  }
+
+  if (rate2 != AL2_INVALID) {
+    uint8_t regs[3];
+    ds3231_encode_al2(rate2, al2, regs);
+    tr.write(DS3231_AL2_MIN, regs, sizeof(regs));
+    ctrl |= 0x02;
+  }
+
+  // with both alarms set this is a single 8-byte burst
+  tr.write(DS3231_CTRL, ctrl).run();
+}
+
+bool DS3231::configure(const Config &cfg) {
+  // SEC..CTRL, STATUS is left out so its flags are never touched
+  uint8_t image[15] = {};
+  uint8_t mask[15] = {};
+  uint16_t force = 0;
+  // alarm and control registers may be rewritten with their own value
+  uint16_t stable = 0x7f80;
+
+  if (cfg.time != nullptr) {
+    ds3231_encode_time(cfg.time, image + DS3231_SEC);
+    force |= 0x007f;
+  }
+
+  if (cfg.al1Rate != AL1_INVALID) {
+    ds3231_encode_al1(cfg.al1Rate, cfg.al1, image + DS3231_AL1_SEC);
+    memset(mask + DS3231_AL1_SEC, 0xff, 4);
+  }
+
+  if (cfg.al2Rate != AL2_INVALID) {
+    ds3231_encode_al2(cfg.al2Rate, cfg.al2, image + DS3231_AL2_MIN);
+    memset(mask + DS3231_AL2_MIN, 0xff, 3);
+  }
+
+  image[DS3231_CTRL] = (cfg.running ? 0 : 0x80) | (cfg.bbsqw ? 0x40 : 0) | cfg.sqwFreq | (cfg.intcn ? 0x04 : 0) |
+                       (cfg.al2Intr ? 0x02 : 0) | (cfg.al1Intr ? 0x01 : 0);
+  // CONV is not configuration
+  mask[DS3231_CTRL] = 0xdf;
+
+  return i2c_rtc_sync_block(_wire, ADDRESS, DS3231_SEC, image, mask, sizeof(image), force, stable);
+}
+
 int8_t DS3231::getAgingOffset() {
   return static_cast<int8_t>(readReg(DS3231_AGING));
 }
@@ -712,53 +1284,165 @@ void DS3231::setAgingOffset(int8_t offset) {
 }
 
 float DS3231::getTemperature() {
-  _wire.beginTransmission(ADDRESS);
-  _wire.write(DS3231_TEMP_MSB);
-  _wire.endTransmission();
+  return getTemperatureQ() / 4.0f;
+}
 
-  _wire.requestFrom(ADDRESS, uint8_t(2));
-  uint8_t msb = _wire.read();
-  uint8_t lsb = _wire.read();
+int16_t DS3231::getTemperatureQ() {
+  uint8_t regs[2];
+  i2c_rtc_read_burst(_wire, ADDRESS, DS3231_TEMP_MSB, regs, sizeof(regs));
+
+  // 10-bit two's complement, MSB holds the integer part
+  return static_cast<int16_t>((regs[0] << 8) | regs[1]) >> 6;
+}
+
+bool DS3231::startTempConv() {
+  BusLock _lock;
+
+  uint8_t regs[2];
+  i2c_rtc_read_burst(_wire, ADDRESS, DS3231_CTRL, regs, sizeof(regs));
+
+  if (regs[0] & 0x20) {
+    // one is already on its way
+    return true;
+  }
+  if (regs[1] & 0x04) {
+    // BSY: the chip's own conversion is running
+    return false;
+  }
+
+  writeReg(DS3231_CTRL, regs[0] | 0x20);
+  return true;
+}
+
+bool DS3231::isTempConvDone() {
+  return (readReg(DS3231_CTRL) & 0x20) == 0;
+}
+
+DS3231Thermometer::DS3231Thermometer(DS3231 &rtc)
+    : _rtc {rtc}, _value {0}, _stamp {0}, _min {0}, _max {0}, _sum {0}, _count {0}, _pending {false} {}
+
+bool DS3231Thermometer::request() {
+  if (_pending) {
+    return true;
+  }
+  _pending = _rtc.startTempConv();
+  return _pending;
+}
+
+bool DS3231Thermometer::poll() {
+  if (!_pending || !_rtc.isTempConvDone()) {
+    return false;
+  }
+
+  _pending = false;
+  _record(_rtc.getTemperatureQ());
+  return true;
+}
+
+int16_t DS3231Thermometer::update() {
+  _record(_rtc.getTemperatureQ());
+  return _value;
+}
 
-  int16_t temp = (msb << 8) | lsb;
-  return temp / 256.0f;
+void DS3231Thermometer::resetStats() {
+  _min = _max = _value;
+  _sum = 0;
+  _count = 0;
+}
+
+void DS3231Thermometer::_record(int16_t value) {
+  _value = value;
+  _stamp = millis();
+
+  if (_count == 0 || value < _min) {
+    _min = value;
+  }
+  if (_count == 0 || value > _max) {
+    _max = value;
+  }
+  if (_count == 0xffff) {
+    // halve the history rather than overflow, the mean stays put
+    _sum /= 2;
+    _count /= 2;
+  }
+  _sum += value;
+  ++_count;
+}
+
+DS3231Timebase::DS3231Timebase(DS3231 &rtc, CounterFn counter, void *ctx)
+    : _rtc {rtc}, _counter {counter}, _ctx {ctx}, _anchorCount {0}, _anchorSecs {0}, _anchored {false} {}
+
+bool DS3231Timebase::begin(uint16_t timeout) {
+  _rtc.set32kHzOut(true);
+  return anchor(timeout);
+}
+
+bool DS3231Timebase::anchor(uint16_t timeout) {
+  uint32_t prev = _counter(_ctx);
+  uint8_t first = _rtc.readReg(DS3231_SEC);
+  uint32_t start = millis();
+
+  for (;;) {
+    uint32_t count = _counter(_ctx);
+    if (_rtc.readReg(DS3231_SEC) != first) {
+      // the second began between the previous read and this one
+      _anchorCount = prev + (count - prev) / 2;
+      _anchorSecs = _rtc.getRawTime().toY2KSeconds();
+      _anchored = true;
+      return true;
+    }
+    if (millis() - start > timeout) {
+      return false;
+    }
+    prev = count;
+  }
+}
+
+DS3231Timebase::Timestamp DS3231Timebase::now() {
+  uint32_t elapsed = _counter(_ctx) - _anchorCount;
+  uint32_t secs = elapsed / TICKS_PER_SEC;
+
+  // roll the anchor forward so that the difference never wraps
+  _anchorSecs += secs;
+  _anchorCount += secs * TICKS_PER_SEC;
+
+  return Timestamp {_anchorSecs, static_cast<uint16_t>(elapsed % TICKS_PER_SEC)};
 }
 
 RX8025T::RX8025T(TwoWire &wire) : _wire {wire} {}
 
 bool RX8025T::setup() {
-  _wire.beginTransmission(ADDRESS);
-  _wire.write(RX8025T_FLAG);
-  if (_wire.endTransmission() != 0) {
+  BusLock _lock;
+
+  uint8_t flag;
+  if (!RegTransaction(_wire, ADDRESS).read(RX8025T_FLAG, &flag).run()) {
     return false;
   }
 
-  _wire.requestFrom(ADDRESS, uint8_t(1));
-  uint8_t flag = _wire.read();
-  _wire.endTransmission();
-
   // check VLF
   if (flag & 0x02) {
-    // reinit all
-    _wire.beginTransmission(ADDRESS);
-    _wire.write(RX8025T_SEC);
-    _wire.write(0x00); // SEC
-    _wire.write(0x00); // MIN
-    _wire.write(0x00); // HOUR
-    _wire.write(0x40); // WEEK
-    _wire.write(0x01); // DAY
-    _wire.write(0x01); // MONTH
-    _wire.write(0x00); // YEAR
-    _wire.write(0x00); // RAM
-    _wire.write(0x00); // AL_MIN
-    _wire.write(0x00); // AL_HOUR
-    _wire.write(0x00); // AL_WK_D
-    _wire.write(0x00); // TIM0
-    _wire.write(0x00); // TIM1
-    _wire.write(0x00); // EXT
-    _wire.write(0x00); // FLAG
-    _wire.write(0x40); // CTRL
-    _wire.endTransmission();
+    // reinit all, writing only the registers that are off
+    static const uint8_t image[16] = {
+        0x00, // SEC
+        0x00, // MIN
+        0x00, // HOUR
+        0x40, // WEEK
+        0x01, // DAY
+        0x01, // MONTH
+        0x00, // YEAR
+        0x00, // RAM
+        0x00, // AL_MIN
+        0x00, // AL_HOUR
+        0x00, // AL_WK_D
+        0x00, // TIM0
+        0x00, // TIM1
+        0x00, // EXT
+        0x00, // FLAG
+        0x40, // CTRL
+    };
+    uint8_t mask[16];
+    memset(mask, 0xff, sizeof(mask));
+    return i2c_rtc_sync_block(_wire, ADDRESS, RX8025T_SEC, image, mask, sizeof(image), 0, 0);
   }
 
   return true;
@@ -773,9 +1457,11 @@ void RX8025T::writeReg(uint8_t addr, uint8_t val) {
 }
 
 void RX8025T::getTime(tm *timeptr) {
+  BusLock _lock;
+
   _wire.beginTransmission(ADDRESS);
   _wire.write(RX8025T_SEC);
-  _wire.endTransmission();
+  _wire.endTransmission(false);
 
   _wire.requestFrom(ADDRESS, uint8_t(7));
   timeptr->tm_sec = bcd2bin(_wire.read() & 0x7f);
@@ -787,33 +1473,52 @@ void RX8025T::getTime(tm *timeptr) {
   timeptr->tm_year = bcd2bin(_wire.read()) + 100;
 }
 
+// encodes time into SEC..YEAR
+static void rx8025t_encode_time(const tm *t, uint8_t *regs) {
+  regs[0] = bin2bcd(t->tm_sec);
+  regs[1] = bin2bcd(t->tm_min);
+  regs[2] = bin2bcd(t->tm_hour);
+  regs[3] = 1U << t->tm_wday;
+  regs[4] = bin2bcd(t->tm_mday);
+  regs[5] = bin2bcd(t->tm_mon + 1);
+  regs[6] = bin2bcd(t->tm_year - 100);
+}
+
 void RX8025T::setTime(const tm *t) {
+  BusLock _lock;
+
+  uint8_t regs[7];
+  rx8025t_encode_time(t, regs);
+
   _wire.beginTransmission(ADDRESS);
   _wire.write(RX8025T_SEC);
-  _wire.write(bin2bcd(t->tm_sec));
-  _wire.write(bin2bcd(t->tm_min));
-  _wire.write(bin2bcd(t->tm_hour));
-  _wire.write(1U << t->tm_wday);
-  _wire.write(bin2bcd(t->tm_mday));
-  _wire.write(bin2bcd(t->tm_mon + 1));
-  _wire.write(bin2bcd(t->tm_year - 100));
+  _wire.write(regs, sizeof(regs));
   _wire.endTransmission();
 }
 
-bool RX8025T::isRunning() {
-  return (readReg(RX8025T_CTRL) & 0x01) == 0;
+RawTime RX8025T::getRawTime() {
+  RawTime raw;
+  raw.chip = RawTime::CHIP_RX8025T;
+  i2c_rtc_read_burst(_wire, ADDRESS, RX8025T_SEC, raw.regs, sizeof(raw.regs));
+  return raw;
 }
 
-void RX8025T::setRunning(bool running) {
-  MASK_BOOL_REG_BITS(RX8025T_CTRL, 0x01, !running);
+TimeStatus RX8025T::getTimeChecked(tm *timeptr) {
+  RawTime raw;
+  TimeStatus status = getRawTimeChecked(&raw);
+  raw.toTm(timeptr);
+  return status;
 }
 
-RX8025T::TempCompIntv RX8025T::getTempCompInterval() {
-  return static_cast<TempCompIntv>(readReg(RX8025T_CTRL) & 0xc0);
-}
+TimeStatus RX8025T::getRawTimeChecked(RawTime *raw) {
+  // FLAG, CTRL, SEC..YEAR; the address wraps after CTRL
+  uint8_t regs[9];
+  i2c_rtc_read_burst(_wire, ADDRESS, RX8025T_FLAG, regs, sizeof(regs));
 
-void RX8025T::setTempCompIntv(TempCompIntv interval) {
-  writeReg(RX8025T_CTRL, (readReg(RX8025T_CTRL) & 0x3f) | interval);
+  raw->chip = RawTime::CHIP_RX8025T;
+  memcpy(raw->regs, regs + 2, sizeof(raw->regs));
+  // RESET, VLF
+  return checked_status(*raw, regs[1] & 0x01, regs[0] & 0x02);
 }
 
 uint8_t RX8025T::getRAM() {
@@ -836,6 +1541,8 @@ RX8025T::TimerFreq RX8025T::getTimerFreq() {
 }
 
 void RX8025T::setTimerFreq(TimerFreq freq) {
+  BusLock _lock;
+
   if (freq == TF_OFF) {
     MASK_BOOL_REG_BITS(RX8025T_EXT, 0x10, 0);
   } else {
@@ -843,24 +1550,8 @@ void RX8025T::setTimerFreq(TimerFreq freq) {
   }
 }
 
-bool RX8025T::isTimerIntrEnabled() {
-  return (readReg(RX8025T_CTRL) & 0x10) != 0;
-}
-
-void RX8025T::setTimerIntrEnabled(bool enabled) {
-  MASK_BOOL_REG_BITS(RX8025T_CTRL, 0x10, enabled);
-}
-
-bool RX8025T::getTimerFlag() {
-  return (readReg(RX8025T_FLAG) & 0x10) != 0;
-}
-
-void RX8025T::clearTimerFlag() {
-  MASK_BOOL_REG_BITS(RX8025T_FLAG, 0x10, 0);
-}
-
 RX8025T::FOUTFreq RX8025T::getFOUT() {
-  uint8_t freq = readReg(RX8025T_CTRL) & 0x0c;
+  uint8_t freq = readReg(RX8025T_EXT) & 0x0c;
   if (freq == 0x0c) {
     // 2'b11 is also 32768Hz
     return FOUT_32768HZ;
@@ -870,45 +1561,17 @@ RX8025T::FOUTFreq RX8025T::getFOUT() {
 }
 
 void RX8025T::setFOUT(FOUTFreq freq) {
-  writeReg(RX8025T_CTRL, (readReg(RX8025T_CTRL) & 0xf3) | freq);
-}
-
-bool RX8025T::getVLF() {
-  return (readReg(RX8025T_FLAG) & 0x02) != 0;
-}
-
-void RX8025T::clearVLF() {
-  MASK_BOOL_REG_BITS(RX8025T_FLAG, 0x02, 0);
-}
+  BusLock _lock;
 
-bool RX8025T::getVDET() {
-  return (readReg(RX8025T_FLAG) & 0x01) != 0;
-}
-
-void RX8025T::clearVDET() {
-  MASK_BOOL_REG_BITS(RX8025T_FLAG, 0x01, 0);
-}
-
-bool RX8025T::getUpdateFlag() {
-  return (readReg(RX8025T_FLAG) & 0x20) != 0;
-}
-
-void RX8025T::clearUpdateFlag() {
-  MASK_BOOL_REG_BITS(RX8025T_FLAG, 0x20, 0);
-}
-
-bool RX8025T::getUSEL() {
-  return (readReg(RX8025T_EXT) & 0x20) != 0;
-}
-
-void RX8025T::setUSEL(bool usel) {
-  MASK_BOOL_REG_BITS(RX8025T_EXT, 0x20, usel);
+  writeReg(RX8025T_EXT, (readReg(RX8025T_EXT) & 0xf3) | freq);
 }
 
 uint16_t RX8025T::getTimer() {
+  BusLock _lock;
+
   _wire.beginTransmission(ADDRESS);
   _wire.write(RX8025T_TIM0);
-  _wire.endTransmission();
+  _wire.endTransmission(false);
 
   _wire.requestFrom(ADDRESS, uint8_t(2));
   uint16_t val = _wire.read();
@@ -917,6 +1580,8 @@ uint16_t RX8025T::getTimer() {
 }
 
 void RX8025T::setTimer(uint16_t val) {
+  BusLock _lock;
+
   _wire.beginTransmission(ADDRESS);
   _wire.write(RX8025T_TIM0);
   _wire.write(val & 0xff);
@@ -925,9 +1590,11 @@ void RX8025T::setTimer(uint16_t val) {
 }
 
 void RX8025T::getAlarm(tm *timeptr) {
+  BusLock _lock;
+
   _wire.beginTransmission(ADDRESS);
   _wire.write(RX8025T_AL_MIN);
-  _wire.endTransmission();
+  _wire.endTransmission(false);
 
   _wire.requestFrom(ADDRESS, uint8_t(6));
   uint8_t min = _wire.read();
@@ -954,83 +1621,154 @@ void RX8025T::getAlarm(tm *timeptr) {
   }
 }
 
-void RX8025T::setAlarm(const tm *timeptr) {
-  uint8_t min = (timeptr->tm_min == -1) ? 0x80 : bin2bcd(timeptr->tm_min);
-  uint8_t hour = (timeptr->tm_hour == -1) ? 0x80 : bin2bcd(timeptr->tm_hour);
-  uint8_t day = timeptr->tm_mday;
-  uint8_t wday = timeptr->tm_wday;
+// encodes alarm into AL_MIN..AL_WK_D, returns the WADA bit to use
+static bool rx8025t_encode_alarm(const tm *timeptr, uint8_t *regs) {
+  int day = timeptr->tm_mday;
+  int wday = timeptr->tm_wday;
   bool wada = false;
 
+  regs[0] = (timeptr->tm_min == -1) ? 0x80 : bin2bcd(timeptr->tm_min);
+  regs[1] = (timeptr->tm_hour == -1) ? 0x80 : bin2bcd(timeptr->tm_hour);
+
   if ((day == -1 && wday == -1) || (day != -1 && wday != -1)) {
     // does not match DAY/WEEK
-    day = 0x80;
+    regs[2] = 0x80;
   } else if (day != -1) {
     // sets DAY as target of alarm function
-    day = bin2bcd(day & 0x3f);
+    regs[2] = bin2bcd(day & 0x3f);
     wada = true;
   } else {
     // sets WEEK as target of alarm function
-    day = wday;
+    regs[2] = wday;
   }
 
-  _wire.beginTransmission(ADDRESS);
-  _wire.write(RX8025T_AL_MIN);
-  _wire.write(min);
-  _wire.write(hour);
-  _wire.write(day);
-  _wire.endTransmission();
+  return wada;
+}
 
-  if ((day & 0x80) == 0) {
-    MASK_BOOL_REG_BITS(RX8025T_EXT, 0x40, wada);
+void RX8025T::setAlarm(const tm *timeptr) {
+  BusLock _lock;
+
+  uint8_t regs[3];
+  bool wada = rx8025t_encode_alarm(timeptr, regs);
+
+  // EXT cannot join the alarm burst, TIM0/TIM1 sit in between and must not
+  // be rewritten; it is only written when WADA changes
+  RegTransaction tr(_wire, ADDRESS);
+  tr.write(RX8025T_AL_MIN, regs, sizeof(regs)).run();
+
+  uint8_t ext;
+  if ((regs[2] & 0x80) == 0 && tr.read(RX8025T_EXT, &ext).run()) {
+    uint8_t val = wada ? (ext | 0x40) : (ext & ~0x40);
+    if (val != ext) {
+      tr.write(RX8025T_EXT, val).run();
+    }
   }
 }
 
-bool RX8025T::isAlarmIntrEnabled() {
-  return (readReg(RX8025T_CTRL) & 0x08) != 0;
-}
+bool RX8025T::configure(const Config &cfg) {
+  // SEC..CTRL. FLAG is never written: it is neither masked nor stable, so
+  // no write span reaches or crosses it, and clearing its flags is left to
+  // serviceInterrupts() and the clear*() methods.
+  uint8_t image[16] = {};
+  uint8_t mask[16] = {};
+  uint16_t force = 0;
+  // RAM, alarm and EXT may be rewritten with their own value, the timer
+  // registers may not as that would restart a running countdown
+  uint16_t stable = 0x2780;
+
+  if (cfg.time != nullptr) {
+    rx8025t_encode_time(cfg.time, image + RX8025T_SEC);
+    force |= 0x007f;
+  }
 
-void RX8025T::setAlarmIntrEnabled(bool enabled) {
-  MASK_BOOL_REG_BITS(RX8025T_CTRL, 0x08, enabled);
-}
+  if (cfg.ram >= 0) {
+    image[RX8025T_RAM] = cfg.ram;
+    mask[RX8025T_RAM] = 0xff;
+  }
+
+  bool wada = false;
+  if (cfg.alarm != nullptr) {
+    wada = rx8025t_encode_alarm(cfg.alarm, image + RX8025T_AL_MIN);
+    memset(mask + RX8025T_AL_MIN, 0xff, 3);
+  }
+
+  if (cfg.timer >= 0) {
+    image[RX8025T_TIM0] = cfg.timer & 0xff;
+    image[RX8025T_TIM1] = (cfg.timer >> 8) & 0x0f;
+    mask[RX8025T_TIM0] = 0xff;
+    mask[RX8025T_TIM1] = 0x0f;
+  }
 
-bool RX8025T::getAlarmFlag() {
-  return (readReg(RX8025T_FLAG) & 0x08) != 0;
+  image[RX8025T_EXT] = (wada ? 0x40 : 0) | (cfg.usel ? 0x20 : 0) | cfg.fout;
+  mask[RX8025T_EXT] = (cfg.alarm != nullptr ? 0x40 : 0) | 0x2c;
+  if (cfg.timerFreq != TF_OFF) {
+    image[RX8025T_EXT] |= 0x10 | cfg.timerFreq;
+  }
+  mask[RX8025T_EXT] |= 0x13;
+
+  image[RX8025T_CTRL] = cfg.tempComp | (cfg.updateIntr ? 0x20 : 0) | (cfg.timerIntr ? 0x10 : 0) |
+                        (cfg.alarmIntr ? 0x08 : 0) | (cfg.running ? 0 : 0x01);
+  mask[RX8025T_CTRL] = 0xf9;
+
+  return i2c_rtc_sync_block(_wire, ADDRESS, RX8025T_SEC, image, mask, sizeof(image), force, stable);
 }
 
-void RX8025T::clearAlarmFlag() {
-  MASK_BOOL_REG_BITS(RX8025T_FLAG, 0x08, 0);
+uint8_t RX8025T::serviceInterrupts(const IntrHandlers &handlers) {
+  uint8_t flags, handled;
+  {
+    BusLock _lock;
+
+    flags = readReg(RX8025T_FLAG) & (INTR_ALARM | INTR_TIMER | INTR_UPDATE);
+    handled = flags & ((handlers.alarm ? INTR_ALARM : 0) | (handlers.timer ? INTR_TIMER : 0) |
+                       (handlers.update ? INTR_UPDATE : 0));
+    if (handled) {
+      // writing 1 to a flag has no effect, 0 clears
+      writeReg(RX8025T_FLAG, 0x3b & ~handled);
+    }
+  }
+
+  if (handled & INTR_ALARM) {
+    handlers.alarm(handlers.ctx);
+  }
+  if (handled & INTR_TIMER) {
+    handlers.timer(handlers.ctx);
+  }
+  if (handled & INTR_UPDATE) {
+    handlers.update(handlers.ctx);
+  }
+  return flags;
 }
 
 PCF8563::PCF8563(TwoWire &wire) : _wire {wire} {}
 
 bool PCF8563::setup() {
-  _wire.beginTransmission(ADDRESS);
-  _wire.write(PCF8563_VL_SEC);
-  if (_wire.endTransmission() != 0) {
+  BusLock _lock;
+
+  // CTRL_1, CTRL_2, VL_SEC
+  uint8_t regs[3];
+  if (!RegTransaction(_wire, ADDRESS).read(PCF8563_CTRL_1, regs, sizeof(regs)).run()) {
     return false;
   }
 
-  _wire.requestFrom(ADDRESS, uint8_t(1));
-  uint8_t vl = _wire.read();
-  _wire.endTransmission();
-
-  _wire.beginTransmission(ADDRESS);
-  _wire.write(PCF8563_CTRL_1);
-  _wire.write(0x00); // Control_status_1
-
-  if (vl & 0x80) {
+  if (regs[2] & 0x80) {
     // VL bit is set
-    _wire.write(0x00); // Control_status_2
-    _wire.write(0x00); // VL_seconds
-    _wire.write(0x00); // Minutes
-    _wire.write(0x00); // Hours
-    _wire.write(0x01); // Days
-    _wire.write(0x05); // Weekdays
-    _wire.write(0x01); // Century_months
-    _wire.write(0x00); // Years
+    static const uint8_t image[] = {
+        0x00, // Control_status_1
+        0x00, // Control_status_2
+        0x00, // VL_seconds
+        0x00, // Minutes
+        0x00, // Hours
+        0x01, // Days
+        0x05, // Weekdays
+        0x01, // Century_months
+        0x00, // Years
+    };
+    return RegTransaction(_wire, ADDRESS).write(PCF8563_CTRL_1, image, sizeof(image)).run();
   }
 
-  _wire.endTransmission();
+  if (regs[0] != 0x00) {
+    return RegTransaction(_wire, ADDRESS).write(PCF8563_CTRL_1, 0x00).run();
+  }
 
   return true;
 }
@@ -1044,9 +1782,11 @@ void PCF8563::writeReg(uint8_t addr, uint8_t val) {
 }
 
 void PCF8563::getTime(tm *timeptr) {
+  BusLock _lock;
+
   _wire.beginTransmission(ADDRESS);
   _wire.write(PCF8563_VL_SEC);
-  _wire.endTransmission();
+  _wire.endTransmission(false);
 
   _wire.requestFrom(ADDRESS, uint8_t(7));
   timeptr->tm_sec = bcd2bin(_wire.read() & 0x7f);
@@ -1065,7 +1805,8 @@ void PCF8563::getTime(tm *timeptr) {
   }
 }
 
-void PCF8563::setTime(const tm *timeptr) {
+// encodes time into VL_SEC..YEAR, clearing VL
+static void pcf8563_encode_time(const tm *timeptr, uint8_t *regs) {
   uint8_t year = timeptr->tm_year - 100;
   uint8_t cen_mon = bin2bcd(timeptr->tm_mon + 1);
 
@@ -1074,24 +1815,65 @@ void PCF8563::setTime(const tm *timeptr) {
     year -= 100;
   }
 
+  regs[0] = bin2bcd(timeptr->tm_sec);
+  regs[1] = bin2bcd(timeptr->tm_min);
+  regs[2] = bin2bcd(timeptr->tm_hour);
+  regs[3] = bin2bcd(timeptr->tm_mday);
+  regs[4] = bin2bcd(timeptr->tm_wday);
+  regs[5] = cen_mon;
+  regs[6] = bin2bcd(year);
+}
+
+void PCF8563::setTime(const tm *timeptr) {
+  BusLock _lock;
+
+  uint8_t regs[7];
+  pcf8563_encode_time(timeptr, regs);
+
   _wire.beginTransmission(ADDRESS);
   _wire.write(PCF8563_VL_SEC);
-  _wire.write(bin2bcd(timeptr->tm_sec));
-  _wire.write(bin2bcd(timeptr->tm_min));
-  _wire.write(bin2bcd(timeptr->tm_hour));
-  _wire.write(bin2bcd(timeptr->tm_mday));
-  _wire.write(bin2bcd(timeptr->tm_wday));
-  _wire.write(cen_mon);
-  _wire.write(bin2bcd(year));
+  _wire.write(regs, sizeof(regs));
   _wire.endTransmission();
 }
 
-bool PCF8563::isRunning() {
-  return (readReg(PCF8563_CTRL_1) & 0x20) == 0;
+RawTime PCF8563::getRawTime() {
+  RawTime raw;
+  raw.chip = RawTime::CHIP_PCF8563;
+  i2c_rtc_read_burst(_wire, ADDRESS, PCF8563_VL_SEC, raw.regs, sizeof(raw.regs));
+  return raw;
+}
+
+TimeStatus PCF8563::getTimeChecked(tm *timeptr) {
+  RawTime raw;
+  TimeStatus status = getRawTimeChecked(&raw);
+  raw.toTm(timeptr);
+  return status;
 }
 
-void PCF8563::setRunning(bool running) {
-  MASK_BOOL_REG_BITS(PCF8563_CTRL_1, 0x20, !running);
+TimeStatus PCF8563::getRawTimeChecked(RawTime *raw) {
+  *raw = getRawTime();
+  // VL
+  return checked_status(*raw, false, raw->regs[0] & 0x80);
+}
+
+void PCF8563::startSubSecTimer() {
+  BusLock _lock;
+
+  setTimerFreq(TF_OFF);
+  setTimer(64);
+  setTimerFreq(TF_64HZ);
+}
+
+RawTime PCF8563::getRawTime(uint8_t *timer) {
+  // TIM, CTRL_1, CTRL_2, VL_SEC..YEAR; the address wraps after TIM
+  uint8_t regs[10];
+  i2c_rtc_read_burst(_wire, ADDRESS, PCF8563_TIM, regs, sizeof(regs));
+
+  RawTime raw;
+  raw.chip = RawTime::CHIP_PCF8563;
+  memcpy(raw.regs, regs + 3, sizeof(raw.regs));
+  *timer = regs[0];
+  return raw;
 }
 
 PCF8563::CLKFreq PCF8563::getCLKOut() {
@@ -1132,34 +1914,12 @@ void PCF8563::setTimerFreq(TimerFreq freq) {
   writeReg(PCF8563_TIM_CTRL, freq);
 }
 
-bool PCF8563::isTimerIntrEnabled() {
-  return (readReg(PCF8563_CTRL_2) & 0x01) != 0;
-}
-
-void PCF8563::setTimerIntrEnabled(bool enabled) {
-  MASK_BOOL_REG_BITS(PCF8563_CTRL_2, 0x01, enabled);
-}
-
-bool PCF8563::getTimerFlag() {
-  return (readReg(PCF8563_CTRL_2) & 0x04) != 0;
-}
-
-void PCF8563::clearTimerFlag() {
-  MASK_BOOL_REG_BITS(PCF8563_CTRL_2, 0x04, 0);
-}
-
-bool PCF8563::isTimerPulseMode() {
-  return (readReg(PCF8563_CTRL_2) & 0x10) != 0;
-}
-
-void PCF8563::setTimerPulseMode(bool pulse_mode) {
-  MASK_BOOL_REG_BITS(PCF8563_CTRL_2, 0x10, pulse_mode);
-}
-
 void PCF8563::getAlarm(tm *timeptr) {
+  BusLock _lock;
+
   _wire.beginTransmission(ADDRESS);
   _wire.write(PCF8563_AL_MIN);
-  _wire.endTransmission();
+  _wire.endTransmission(false);
 
   _wire.requestFrom(ADDRESS, uint8_t(4));
   uint8_t min = _wire.read();
@@ -1173,33 +1933,288 @@ void PCF8563::getAlarm(tm *timeptr) {
   timeptr->tm_wday = (wday & 0x80) ? -1 : bcd2bin(wday & 0x07);
 }
 
+// encodes alarm into AL_MIN..AL_WEEK, -1 fields are disabled
+static void pcf8563_encode_alarm(const tm *timeptr, uint8_t *regs) {
+  regs[0] = (timeptr->tm_min == -1) ? 0x80 : bin2bcd(timeptr->tm_min);
+  regs[1] = (timeptr->tm_hour == -1) ? 0x80 : bin2bcd(timeptr->tm_hour);
+  regs[2] = (timeptr->tm_mday == -1) ? 0x80 : bin2bcd(timeptr->tm_mday);
+  regs[3] = (timeptr->tm_wday == -1) ? 0x80 : bin2bcd(timeptr->tm_wday);
+}
+
 void PCF8563::setAlarm(const tm *timeptr) {
-  uint8_t min = (timeptr->tm_min == -1) ? 0x80 : bin2bcd(timeptr->tm_min);
-  uint8_t hour = (timeptr->tm_hour == -1) ? 0x80 : bin2bcd(timeptr->tm_hour);
-  uint8_t day = (timeptr->tm_mday == -1) ? 0x80 : bin2bcd(timeptr->tm_mday);
-  uint8_t wday = (timeptr->tm_wday == -1) ? 0x80 : bin2bcd(timeptr->tm_wday);
+  BusLock _lock;
+
+  uint8_t regs[4];
+  pcf8563_encode_alarm(timeptr, regs);
 
   _wire.beginTransmission(ADDRESS);
   _wire.write(PCF8563_AL_MIN);
-  _wire.write(min);
-  _wire.write(hour);
-  _wire.write(day);
-  _wire.write(wday);
+  _wire.write(regs, sizeof(regs));
   _wire.endTransmission();
 }
 
-bool PCF8563::isAlarmIntrEnabled() {
-  return (readReg(PCF8563_CTRL_2) & 0x02) != 0;
+bool PCF8563::configure(const Config &cfg) {
+  uint8_t image[16] = {};
+  uint8_t mask[16] = {};
+  uint16_t force = 0;
+  // CTRL_1, alarm, CLKOUT and TIM_CTRL may be rewritten with their own value,
+  // CTRL_2 may not as that could clear a flag raised in the meantime
+  uint16_t stable = 0x7e01;
+
+  image[PCF8563_CTRL_1] = cfg.running ? 0 : 0x20;
+  mask[PCF8563_CTRL_1] = 0xff;
+
+  // AF and TF are written as ones, which leaves them untouched
+  image[PCF8563_CTRL_2] = (cfg.timerPulse ? 0x10 : 0) | 0x0c | (cfg.alarmIntr ? 0x02 : 0) | (cfg.timerIntr ? 0x01 : 0);
+  mask[PCF8563_CTRL_2] = 0x13;
+
+  if (cfg.time != nullptr) {
+    pcf8563_encode_time(cfg.time, image + PCF8563_VL_SEC);
+    force |= 0x01fc;
+  }
+
+  if (cfg.alarm != nullptr) {
+    pcf8563_encode_alarm(cfg.alarm, image + PCF8563_AL_MIN);
+    memset(mask + PCF8563_AL_MIN, 0xff, 4);
+  }
+
+  image[PCF8563_CLKOUT] = cfg.clkout;
+  mask[PCF8563_CLKOUT] = 0x83;
+
+  image[PCF8563_TIM_CTRL] = cfg.timerFreq;
+  mask[PCF8563_TIM_CTRL] = 0x83;
+
+  if (cfg.timer >= 0) {
+    image[PCF8563_TIM] = cfg.timer;
+    mask[PCF8563_TIM] = 0xff;
+  }
+
+  return i2c_rtc_sync_block(_wire, ADDRESS, PCF8563_CTRL_1, image, mask, sizeof(image), force, stable);
+}
+
+uint8_t PCF8563::serviceInterrupts(const IntrHandlers &handlers) {
+  uint8_t flags, handled;
+  {
+    BusLock _lock;
+
+    uint8_t ctrl = readReg(PCF8563_CTRL_2);
+    flags = ctrl & (INTR_TIMER | INTR_ALARM);
+    handled = flags & ((handlers.alarm ? INTR_ALARM : 0) | (handlers.timer ? INTR_TIMER : 0));
+    if (handled) {
+      // TI_TP, AIE and TIE as read; writing 1 leaves AF/TF as they are
+      writeReg(PCF8563_CTRL_2, (ctrl & 0x13) | (0x0c & ~handled));
+    }
+  }
+
+  if (handled & INTR_ALARM) {
+    handlers.alarm(handlers.ctx);
+  }
+  if (handled & INTR_TIMER) {
+    handlers.timer(handlers.ctx);
+  }
+  return flags;
+}
+
+PCF8563SubSecond::PCF8563SubSecond(PCF8563 &rtc) : _rtc {rtc}, _phase {0}, _synced {false} {}
+
+bool PCF8563SubSecond::begin(uint16_t timeout) {
+  _rtc.startSubSecTimer();
+  return sync(timeout);
+}
+
+bool PCF8563SubSecond::sync(uint16_t timeout) {
+  uint8_t timer;
+  uint8_t first = _rtc.getRawTime(&timer).regs[0];
+  uint32_t start = millis();
+
+  for (;;) {
+    RawTime raw = _rtc.getRawTime(&timer);
+    if (raw.regs[0] != first) {
+      // one 64 Hz step outlasts many polls, so this is the rollover value
+      _phase = timer;
+      _synced = true;
+      return true;
+    }
+    if (millis() - start > timeout) {
+      return false;
+    }
+  }
+}
+
+RawTime PCF8563SubSecond::now(uint16_t *ms) {
+  uint8_t timer;
+  RawTime raw = _rtc.getRawTime(&timer);
+
+  // counts down 64..1, 64 and 0 being the same position
+  uint8_t ticks = (_phase - timer) & 0x3f;
+  *ms = (ticks * 125U) >> 3;
+  return raw;
+}
+
+TimeZone::TimeZone(int16_t offset)
+    : _dst {1, 1, 0, 0, offset}, _std {1, 1, 0, 0, offset}, _hasDST {false}, _year {0}, _yearStart {0},
+      _yearEnd {0}, _dstStart {0}, _dstEnd {0}, _dayStart {0xffffffff}, _day {} {}
+
+TimeZone::TimeZone(const DSTRule &dst, const DSTRule &std)
+    : _dst {dst}, _std {std}, _hasDST {true}, _year {0}, _yearStart {0}, _yearEnd {0}, _dstStart {0},
+      _dstEnd {0}, _dayStart {0xffffffff}, _day {} {}
+
+uint32_t TimeZone::_change(uint16_t year, const DSTRule &rule, int16_t before) const {
+  static const uint8_t mdays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+  uint16_t first = days_since_2000(year, rule.month, 1);
+  // 2000-01-01 was a Saturday
+  uint8_t mday = 1 + (rule.wday + 7 - (first + 6) % 7) % 7 + 7 * (rule.week - 1);
+  uint8_t last = mdays[rule.month - 1] + (rule.month == 2 && is_leap(year));
+  while (mday > last) {
+    mday -= 7;
+  }
+
+  return (first + mday - 1) * 86400UL + rule.hour * 3600UL - before * 60L;
+}
+
+void TimeZone::_loadYear(uint32_t utc) {
+  // the local year may differ near new year, but no zone changes then
+  uint16_t year = 2000 + utc / 31556952UL;
+  if (days_since_2000(year, 1, 1) * 86400UL > utc) {
+    --year;
+  } else if (days_since_2000(year + 1, 1, 1) * 86400UL <= utc) {
+    ++year;
+  }
+
+  _year = year;
+  _yearStart = days_since_2000(year, 1, 1) * 86400UL;
+  _yearEnd = days_since_2000(year + 1, 1, 1) * 86400UL;
+  _dstStart = _change(year, _dst, _std.offset);
+  _dstEnd = _change(year, _std, _dst.offset);
+}
+
+bool TimeZone::isDST(uint32_t utc) {
+  if (!_hasDST) {
+    return false;
+  }
+  if (_year == 0 || utc < _yearStart || utc >= _yearEnd) {
+    _loadYear(utc);
+  }
+
+  // southern zones have DST across new year
+  return _dstStart < _dstEnd ? (utc >= _dstStart && utc < _dstEnd) : (utc >= _dstStart || utc < _dstEnd);
+}
+
+void TimeZone::toTm(uint32_t utc, tm *timeptr) {
+  bool dst = isDST(utc);
+  uint32_t local = utc + (dst ? _dst.offset : _std.offset) * 60L;
+
+  // _dayStart starts out past any time, so the first call decodes
+  if (local < _dayStart || local - _dayStart >= 86400UL) {
+    uint16_t days = local / 86400UL;
+    _dayStart = days * 86400UL;
+
+    uint16_t year = 2000 + days * 400UL / 146097;
+    if (days_since_2000(year, 1, 1) > days) {
+      --year;
+    }
+    uint8_t mon = 1;
+    while (mon < 12 && days_since_2000(year, mon + 1, 1) <= days) {
+      ++mon;
+    }
+
+    _day.tm_year = year - 1900;
+    _day.tm_mon = mon - 1;
+    _day.tm_mday = days - days_since_2000(year, mon, 1) + 1;
+    _day.tm_yday = days - days_since_2000(year, 1, 1);
+    _day.tm_wday = (days + 6) % 7;
+  }
+
+  uint32_t secs = local - _dayStart;
+  *timeptr = _day;
+  timeptr->tm_hour = secs / 3600;
+  timeptr->tm_min = secs / 60 % 60;
+  timeptr->tm_sec = secs % 60;
+  timeptr->tm_isdst = dst;
+}
+
+// false if nobody answers at dev
+static bool i2c_probe_burst(TwoWire &wire, uint8_t dev, uint8_t addr, uint8_t *buf, uint8_t len) {
+  BusLock _lock;
+
+  wire.beginTransmission(dev);
+  wire.write(addr);
+  if (wire.endTransmission(false) != 0 || wire.requestFrom(dev, len) != len) {
+    return false;
+  }
+  for (uint8_t i = 0; i < len; ++i) {
+    buf[i] = wire.read();
+  }
+  return true;
 }
 
-void PCF8563::setAlarmIntrEnabled(bool enabled) {
-  MASK_BOOL_REG_BITS(PCF8563_CTRL_2, 0x02, enabled);
+static bool raw_plausible(const uint8_t *regs, RawTime::Chip chip) {
+  RawTime raw;
+  memcpy(raw.regs, regs, sizeof(raw.regs));
+  raw.chip = chip;
+  return raw.isPlausible();
 }
 
-bool PCF8563::getAlarmFlag() {
-  return (readReg(PCF8563_CTRL_2) & 0x08) != 0;
+bool DetectedRTC::best(RawTime::Chip *chip) const {
+  static const RawTime::Chip order[] = {RawTime::CHIP_DS3231, RawTime::CHIP_RX8025T, RawTime::CHIP_PCF8563,
+                                        RawTime::CHIP_DS1307};
+  for (RawTime::Chip c : order) {
+    if (has(c)) {
+      *chip = c;
+      return true;
+    }
+  }
+  return false;
 }
 
-void PCF8563::clearAlarmFlag() {
-  MASK_BOOL_REG_BITS(PCF8563_CTRL_2, 0x08, 0);
+DetectedRTC detectRTC(TwoWire &wire) {
+  DetectedRTC found = {0, 0};
+  uint8_t buf[26];
+
+  // 0x00..0x12 and on: a DS3231 wraps and repeats its time registers at 19,
+  // a DS1307 goes on into RAM. The seconds may roll over between the two
+  // copies, so they are left out, and a mismatch in minutes and up (a
+  // rollover of those, or a DS1307) gets a second burst.
+  bool read = false, wraps = false;
+  for (uint8_t i = 0; i < 2 && !wraps; ++i) {
+    read = i2c_probe_burst(wire, DS3231::ADDRESS, DS3231_SEC, buf, 26);
+    if (!read) {
+      break;
+    }
+    wraps = memcmp(buf + 1, buf + 0x14, 6) == 0;
+  }
+  if (wraps && (buf[DS3231_STATUS] & 0x70) == 0 && (buf[DS3231_TEMP_LSB] & 0x3f) == 0) {
+    found.chips |= 1 << RawTime::CHIP_DS3231;
+    if (!raw_plausible(buf, RawTime::CHIP_DS3231)) {
+      found.badTime |= 1 << RawTime::CHIP_DS3231;
+    }
+  } else if (read && !wraps && (buf[DS1307_CTRL] & 0x6c) == 0 && raw_plausible(buf, RawTime::CHIP_DS1307)) {
+    // CTRL alone says little; the DS1307 powers up with a valid date, so
+    // the time registers are part of its fingerprint
+    found.chips |= 1 << RawTime::CHIP_DS1307;
+  }
+
+  // 0x0d..0x0f, the time, and 0x0d..0x0f again after the wrap at 0x0f; EXT
+  // and CTRL must repeat, the reserved bits of FLAG and CTRL read 0
+  if (i2c_probe_burst(wire, RX8025T::ADDRESS, RX8025T_EXT, buf, 19) && buf[0] == buf[16] && buf[2] == buf[18] &&
+      (buf[1] & 0xc4) == 0 && (buf[2] & 0x06) == 0) {
+    found.chips |= 1 << RawTime::CHIP_RX8025T;
+    // the weekday is one-hot
+    if (!raw_plausible(buf + 3, RawTime::CHIP_RX8025T) || buf[6] == 0 || (buf[6] & (buf[6] - 1)) != 0 ||
+        buf[6] >= 0x80) {
+      found.badTime |= 1 << RawTime::CHIP_RX8025T;
+    }
+  }
+
+  // control registers, the time, and both controls again after the wrap
+  if (i2c_probe_burst(wire, PCF8563::ADDRESS, PCF8563_CTRL_1, buf, 18) && buf[0] == buf[16] && buf[1] == buf[17] &&
+      (buf[0] & 0x57) == 0 && (buf[1] & 0xe0) == 0) {
+    found.chips |= 1 << RawTime::CHIP_PCF8563;
+    if (!raw_plausible(buf + PCF8563_VL_SEC, RawTime::CHIP_PCF8563)) {
+      found.badTime |= 1 << RawTime::CHIP_PCF8563;
+    }
+  }
+
+  return found;
 }
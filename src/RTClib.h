@@ -1,11 +1,40 @@
 #ifndef __RTCLIB_H__
 #define __RTCLIB_H__
 
+#include <string.h>
 #include <time.h>
+#ifdef ARDUINO
 #include <Arduino.h>
 #include <Wire.h>
+#else
+#include "RTClib_linux.h"
+#endif
+#include "RTClib_lock.h"
 
 namespace __rtclib_details {
+  constexpr uint8_t bcd2bin(uint8_t val) {
+    return val - 6 * (val >> 4);
+  }
+
+  constexpr uint8_t bin2bcd(uint8_t val) {
+    return val + 6 * (val / 10);
+  }
+
+  // Control bits of the I2C chips are described as register << 8 | mask and
+  // go through this one pair, so that each getter and setter compiles to a
+  // call with a constant instead of a read-modify-write sequence of its own.
+  // Values are in register position.
+  uint8_t i2c_get_bits(TwoWire &wire, uint8_t dev, uint16_t field);
+  // sets the field to val & mask; no write when the bits already match
+  void i2c_set_bits(TwoWire &wire, uint8_t dev, uint16_t field, uint8_t val);
+
+#ifdef __AVR__
+  // avr-libc counts time_t from 2000-01-01
+  constexpr time_t y2k_epoch = 0;
+#else
+  constexpr time_t y2k_epoch = 946684800;
+#endif
+
   template <typename T>
   class RAMRef {
     T *_thisPtr;
@@ -80,6 +109,10 @@ namespace __rtclib_details {
 
     RAMRef<T> operator*() { return RAMRef<T>(_thisPtr, _index); }
 
+    bool operator==(const RAMPtr &other) const { return _index == other._index; }
+    bool operator!=(const RAMPtr &other) const { return _index != other._index; }
+    bool operator<(const RAMPtr &other) const { return _index < other._index; }
+
     RAMPtr operator++(int) { return RAMPtr(_thisPtr, _index++); }
     RAMPtr operator--(int) { return RAMPtr(_thisPtr, _index--); }
     RAMPtr &operator++() {
@@ -93,6 +126,126 @@ namespace __rtclib_details {
   };
 }; // namespace __rtclib_details
 
+// 32-bit sortable timestamp with FAT-like bitfields at full-second
+// resolution, covering 2000..2063:
+// year - 2000 (6) | month (4) | mday (5) | hour (5) | minute (6) | second (6)
+struct PackedTime {
+  uint32_t value;
+
+  constexpr uint8_t second() const { return value & 0x3f; }
+  constexpr uint8_t minute() const { return (value >> 6) & 0x3f; }
+  constexpr uint8_t hour() const { return (value >> 12) & 0x1f; }
+  constexpr uint8_t mday() const { return (value >> 17) & 0x1f; }
+  constexpr uint8_t month() const { return (value >> 22) & 0x0f; }
+  constexpr uint16_t year() const { return 2000 + (value >> 26); }
+
+  // FAT directory entry date and time, the latter at 2-second resolution
+  constexpr uint16_t fatDate() const { return ((year() - 1980) << 9) | (month() << 5) | mday(); }
+  constexpr uint16_t fatTime() const { return (hour() << 11) | (minute() << 5) | (second() >> 1); }
+
+  void toTm(tm *timeptr) const;
+  uint32_t toY2KSeconds() const;
+
+  // seconds elapsed from other to this
+  int32_t operator-(const PackedTime &other) const {
+    return static_cast<int32_t>(toY2KSeconds() - other.toY2KSeconds());
+  }
+
+  constexpr bool operator==(const PackedTime &other) const { return value == other.value; }
+  constexpr bool operator!=(const PackedTime &other) const { return value != other.value; }
+  constexpr bool operator<(const PackedTime &other) const { return value < other.value; }
+  constexpr bool operator>(const PackedTime &other) const { return value > other.value; }
+  constexpr bool operator<=(const PackedTime &other) const { return value <= other.value; }
+  constexpr bool operator>=(const PackedTime &other) const { return value >= other.value; }
+};
+
+// The 7 time registers as read from the chip, decoded only on demand.
+// 8 bytes regardless of target, cheap to queue and to compare.
+struct RawTime {
+  enum Chip : uint8_t {
+    CHIP_DS1302,
+    CHIP_DS1307,
+    CHIP_DS3231,
+    CHIP_RX8025T,
+    CHIP_PCF8563,
+  };
+
+  // seconds, minutes, hours, then day/weekday/month in chip order, then year
+  uint8_t regs[7];
+  Chip chip;
+
+  constexpr uint8_t second() const { return __rtclib_details::bcd2bin(regs[0] & 0x7f); }
+  constexpr uint8_t minute() const { return __rtclib_details::bcd2bin(regs[1] & 0x7f); }
+  constexpr uint8_t hour() const { return __rtclib_details::bcd2bin(regs[2] & 0x3f); }
+  // day of month, 1-31
+  constexpr uint8_t mday() const { return __rtclib_details::bcd2bin(regs[_mdayIdx()] & 0x3f); }
+  // 1-12
+  constexpr uint8_t month() const { return __rtclib_details::bcd2bin(regs[_monIdx()] & 0x1f); }
+  // full year, e.g. 2024
+  constexpr uint16_t year() const { return 2000 + __rtclib_details::bcd2bin(regs[6]) + (_century() ? 100 : 0); }
+  // 0 is Sunday, same as tm_wday
+  constexpr uint8_t wday() const {
+    return chip == CHIP_RX8025T   ? (regs[3] ? __builtin_ctz(regs[3]) : 0)
+           : chip == CHIP_PCF8563 ? (regs[4] & 0x07)
+                                  : (regs[_wdayIdx()] & 0x07) % 7;
+  }
+
+  void toTm(tm *timeptr) const;
+  time_t toEpoch() const;
+  // seconds since 2000-01-01 00:00:00, fits 32 bits until 2136
+  uint32_t toY2KSeconds() const;
+  // every field is well-formed BCD and in range, i.e. not bus garbage
+  bool isPlausible() const;
+
+  constexpr PackedTime toPacked() const {
+    return PackedTime {(uint32_t(year() - 2000) << 26) | (uint32_t(month()) << 22) | (uint32_t(mday()) << 17) |
+                       (uint32_t(hour()) << 12) | (uint32_t(minute()) << 6) | second()};
+  }
+
+  // ordering works on the BCD bytes, no decoding involved
+  constexpr bool operator==(const RawTime &other) const {
+    return _dateKey() == other._dateKey() && _timeKey() == other._timeKey();
+  }
+  constexpr bool operator!=(const RawTime &other) const { return !(*this == other); }
+  constexpr bool operator<(const RawTime &other) const {
+    return _dateKey() < other._dateKey() || (_dateKey() == other._dateKey() && _timeKey() < other._timeKey());
+  }
+  constexpr bool operator>(const RawTime &other) const { return other < *this; }
+  constexpr bool operator<=(const RawTime &other) const { return !(other < *this); }
+  constexpr bool operator>=(const RawTime &other) const { return !(*this < other); }
+
+private:
+  constexpr uint8_t _mdayIdx() const { return (chip == CHIP_DS1302 || chip == CHIP_PCF8563) ? 3 : 4; }
+  constexpr uint8_t _monIdx() const { return chip == CHIP_DS1302 ? 4 : 5; }
+  constexpr uint8_t _wdayIdx() const { return chip == CHIP_DS1302 ? 5 : 3; }
+  constexpr bool _century() const {
+    return (chip == CHIP_DS3231 || chip == CHIP_PCF8563) && (regs[5] & 0x80);
+  }
+  constexpr uint32_t _dateKey() const {
+    return (uint32_t(_century()) << 19) | (uint32_t(regs[6]) << 11) | (uint32_t(regs[_monIdx()] & 0x1f) << 6) |
+           (regs[_mdayIdx()] & 0x3f);
+  }
+  constexpr uint32_t _timeKey() const {
+    return (uint32_t(regs[2] & 0x3f) << 14) | (uint32_t(regs[1] & 0x7f) << 7) | (regs[0] & 0x7f);
+  }
+};
+
+// What getTimeChecked() and getRawTimeChecked() tell about the time they
+// read. The flags come from the same read as the time, so the check adds no
+// transaction.
+enum TimeStatus : uint8_t {
+  TIME_OK,
+  // the oscillator stopped at some point since the flag was cleared: OSF
+  // (DS3231, clearOSF()), VLF (RX8025T, clearVLF()), VL (PCF8563, setTime())
+  TIME_LOST,
+  // the clock is halted: CH (DS1302, DS1307), RESET (RX8025T)
+  TIME_STOPPED,
+  // registers out of range, e.g. nothing answered on the bus
+  TIME_INVALID,
+};
+
+// DS1302 is bit-banged over GPIO. On Linux the pins are those of
+// FakeDS1302, for host-side checks only.
 class DS1302 {
   using RAMRef = __rtclib_details::RAMRef<DS1302>;
   using RAMPtr = __rtclib_details::RAMPtr<DS1302>;
@@ -126,9 +279,15 @@ public:
 
   uint8_t readRAM(uint8_t index);
   void writeRAM(uint8_t index, uint8_t val);
+  // bulk transfers, clipped to RAM_SIZE
+  void readRAM(uint8_t index, uint8_t *buf, uint8_t len);
+  void writeRAM(uint8_t index, const uint8_t *buf, uint8_t len);
 
   void getTime(tm *timeptr);
   void setTime(const tm *timeptr);
+  RawTime getRawTime();
+  TimeStatus getTimeChecked(tm *timeptr);
+  TimeStatus getRawTimeChecked(RawTime *raw);
 
   bool isRunning();
   void setRunning(bool running);
@@ -147,6 +306,14 @@ class DS1307 {
 
   TwoWire &_wire;
 
+  // control bits, register << 8 | mask
+  enum Field : uint16_t {
+    F_CH = 0x0080, // SEC
+  };
+
+  uint8_t _get(Field f) { return __rtclib_details::i2c_get_bits(_wire, ADDRESS, f); }
+  void _set(Field f, uint8_t val) { __rtclib_details::i2c_set_bits(_wire, ADDRESS, f, val); }
+
 public:
   enum SqWaveFreq : uint8_t {
     SO_LOW = 0x00,   // keep sqw pin low
@@ -169,12 +336,18 @@ public:
 
   uint8_t readRAM(uint8_t index);
   void writeRAM(uint8_t index, uint8_t val);
+  // bulk transfers, clipped to RAM_SIZE
+  void readRAM(uint8_t index, uint8_t *buf, uint8_t len);
+  void writeRAM(uint8_t index, const uint8_t *buf, uint8_t len);
 
   void getTime(tm *timeptr);
   void setTime(const tm *timeptr);
+  RawTime getRawTime();
+  TimeStatus getTimeChecked(tm *timeptr);
+  TimeStatus getRawTimeChecked(RawTime *raw);
 
-  bool isRunning();
-  void setRunning(bool running);
+  bool isRunning() { return !_get(F_CH); }
+  void setRunning(bool running) { _set(F_CH, running ? 0 : 0xff); }
 
   SqWaveFreq getSQWOut();
   void setSQWOut(SqWaveFreq value);
@@ -184,9 +357,237 @@ public:
   RAMRef operator[](int index) { return RAMRef(this, index); }
 };
 
+// Write-back cache over the RAM of a DS1302 or DS1307. The whole RAM is
+// loaded in bulk on first access; writes only mark bytes dirty, and flush()
+// (or the destructor) writes the dirty spans back in bursts. Same iterator
+// and operator[] syntax as the chip itself:
+//
+//   {
+//     RAMCache<DS1307> ram(rtc);
+//     for (auto p = ram.begin(); p != ram.end(); ++p) {
+//       *p += 1;
+//     }
+//   } // one bulk read, one bulk write
+template <typename RTC>
+class RAMCache {
+  using RAMRef = __rtclib_details::RAMRef<RAMCache>;
+  using RAMPtr = __rtclib_details::RAMPtr<RAMCache>;
+
+  // clean bytes between dirty spans that are rewritten rather than split
+  static constexpr uint8_t MAX_GAP = 2;
+
+  RTC &_rtc;
+  uint8_t _data[RTC::RAM_SIZE];
+  uint8_t _dirty[(RTC::RAM_SIZE + 7) / 8];
+  bool _loaded;
+
+  bool _isDirty(uint8_t index) const { return _dirty[index >> 3] & (1 << (index & 7)); }
+
+  template <typename R>
+  void _flush(R &rtc) {
+    for (uint8_t i = 0; i < RAM_SIZE; ++i) {
+      if (!_isDirty(i)) {
+        continue;
+      }
+
+      uint8_t end = i + 1;
+      for (uint8_t j = end; j < RAM_SIZE && j - end <= MAX_GAP; ++j) {
+        if (_isDirty(j)) {
+          end = j + 1;
+        }
+      }
+
+      rtc.writeRAM(i, _data + i, end - i);
+      i = end;
+    }
+  }
+
+  // DS1302 bursts start at index 0 and the cache already holds the bytes
+  // before any span, so one burst up to the last dirty byte covers it all
+  void _flush(DS1302 &rtc) {
+    uint8_t end = RAM_SIZE;
+    while (end > 0 && !_isDirty(end - 1)) {
+      --end;
+    }
+    if (end > 0) {
+      rtc.writeRAM(0, _data, end);
+    }
+  }
+
+public:
+  static constexpr uint8_t RAM_SIZE = RTC::RAM_SIZE;
+
+  explicit RAMCache(RTC &rtc) : _rtc {rtc}, _data {}, _dirty {}, _loaded {false} {}
+  ~RAMCache() { flush(); }
+
+  RAMCache(const RAMCache &) = delete;
+  RAMCache &operator=(const RAMCache &) = delete;
+
+  uint8_t readRAM(uint8_t index) {
+    if (index >= RAM_SIZE) {
+      return 0;
+    }
+    load();
+    return _data[index];
+  }
+
+  void writeRAM(uint8_t index, uint8_t val) {
+    if (index >= RAM_SIZE) {
+      return;
+    }
+    load();
+    if (_data[index] != val) {
+      _data[index] = val;
+      _dirty[index >> 3] |= 1 << (index & 7);
+    }
+  }
+
+  // loads the RAM if not done yet
+  void load() {
+    if (!_loaded) {
+      _rtc.readRAM(0, _data, RAM_SIZE);
+      _loaded = true;
+    }
+  }
+
+  // drops the cache, pending writes included
+  void invalidate() {
+    _loaded = false;
+    memset(_dirty, 0, sizeof(_dirty));
+  }
+
+  bool isDirty() const {
+    for (uint8_t i = 0; i < sizeof(_dirty); ++i) {
+      if (_dirty[i]) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void flush() {
+    _flush(_rtc);
+    memset(_dirty, 0, sizeof(_dirty));
+  }
+
+  RAMPtr begin() { return RAMPtr(this, 0); }
+  RAMPtr end() { return RAMPtr(this, RAM_SIZE); }
+  RAMRef operator[](int index) { return RAMRef(this, index); }
+};
+
+// A T kept in RTC RAM at a fixed offset, followed by a checksum byte. The
+// layout is fixed at compile time; chain slots through END:
+//
+//   using BootCount = Persistent<DS1307, uint16_t>;
+//   using Calib = Persistent<DS1307, CalibData, BootCount::END>;
+//
+// The slot is read and written as one bulk transfer (a DS1302 write away
+// from index 0 takes two, see DS1302::writeRAM()), and the value is cached
+// after the first load. T must be a plain struct or scalar. With
+// Checked = false the checksum byte is left out, e.g. for the single RAM
+// byte of the RX8025T.
+template <typename RTC, typename T, uint8_t Offset = 0, bool Checked = true>
+class Persistent {
+public:
+  static constexpr uint8_t OFFSET = Offset;
+  static constexpr uint8_t SIZE = sizeof(T) + (Checked ? 1 : 0);
+  static constexpr uint8_t END = Offset + SIZE;
+
+  static_assert(sizeof(T) + (Checked ? 1 : 0) + Offset <= RTC::RAM_SIZE, "Persistent slot exceeds RTC RAM");
+
+  explicit Persistent(RTC &rtc) : _rtc {rtc}, _value {}, _loaded {false}, _valid {false} {}
+
+  // Reads the slot. On a checksum mismatch (never written, lost power) the
+  // value reads as T {} and false is returned.
+  bool load() {
+    uint8_t buf[SIZE];
+    _rtc.readRAM(Offset, buf, SIZE);
+
+    _valid = !Checked || buf[sizeof(T)] == _checksum(buf);
+    if (_valid) {
+      memcpy(&_value, buf, sizeof(T));
+    } else {
+      _value = T {};
+    }
+    _loaded = true;
+    return _valid;
+  }
+
+  // false if the slot held garbage when loaded
+  bool isValid() {
+    if (!_loaded) {
+      load();
+    }
+    return _valid;
+  }
+
+  const T &get() {
+    if (!_loaded) {
+      load();
+    }
+    return _value;
+  }
+
+  // writes value and checksum, unless the chip already holds them
+  void set(const T &value) {
+    if (_loaded && _valid && memcmp(&_value, &value, sizeof(T)) == 0) {
+      return;
+    }
+
+    uint8_t buf[SIZE];
+    memcpy(buf, &value, sizeof(T));
+    if (Checked) {
+      buf[sizeof(T)] = _checksum(buf);
+    }
+    _rtc.writeRAM(Offset, buf, SIZE);
+
+    _value = value;
+    _loaded = true;
+    _valid = true;
+  }
+
+  operator const T &() { return get(); }
+  Persistent &operator=(const T &value) {
+    set(value);
+    return *this;
+  }
+
+private:
+  RTC &_rtc;
+  T _value;
+  bool _loaded;
+  bool _valid;
+
+  // rotate-xor over the data, seeded so that blank (zeroed) RAM fails
+  static uint8_t _checksum(const uint8_t *buf) {
+    uint8_t sum = 0x5a ^ Offset;
+    for (uint8_t i = 0; i < sizeof(T); ++i) {
+      sum = ((sum << 1) | (sum >> 7)) ^ buf[i];
+    }
+    return sum;
+  }
+};
+
 class DS3231 {
   TwoWire &_wire;
 
+  // control bits, register << 8 | mask
+  enum Field : uint16_t {
+    F_EOSC = 0x0e80, // CTRL
+    F_BBSQW = 0x0e40,
+    F_RS = 0x0e18,
+    F_INTCN = 0x0e04,
+    F_A2IE = 0x0e02,
+    F_A1IE = 0x0e01,
+    F_OSF = 0x0f80, // STATUS
+    F_EN32KHZ = 0x0f08,
+    F_A2F = 0x0f02,
+    F_A1F = 0x0f01,
+  };
+
+  uint8_t _get(Field f) { return __rtclib_details::i2c_get_bits(_wire, ADDRESS, f); }
+  void _set(Field f, uint8_t val) { __rtclib_details::i2c_set_bits(_wire, ADDRESS, f, val); }
+
 public:
   enum SqWaveFreq : uint8_t {
     SQW_1HZ = 0x0,
@@ -216,6 +617,22 @@ public:
 
   static constexpr uint8_t ADDRESS = 0x68;
 
+  // Desired state of SEC..CTRL, applied by configure(). Defaults match the
+  // power-on state of the control register.
+  struct Config {
+    const tm *time = nullptr; // nullptr keeps the current time
+    Alarm1Rate al1Rate = AL1_INVALID; // AL1_INVALID keeps alarm 1 registers
+    const tm *al1 = nullptr;
+    Alarm2Rate al2Rate = AL2_INVALID; // AL2_INVALID keeps alarm 2 registers
+    const tm *al2 = nullptr;
+    bool running = true;
+    bool bbsqw = false;
+    SqWaveFreq sqwFreq = SQW_8192HZ;
+    bool intcn = true;
+    bool al1Intr = false;
+    bool al2Intr = false;
+  };
+
   explicit DS3231(TwoWire &wire = Wire);
 
   bool setup();
@@ -225,47 +642,192 @@ public:
 
   void getTime(tm *timeptr);
   void setTime(const tm *timeptr);
+  RawTime getRawTime();
+  TimeStatus getTimeChecked(tm *timeptr);
+  TimeStatus getRawTimeChecked(RawTime *raw);
 
-  bool isRunning();
-  void setRunning(bool running);
+  bool isRunning() { return !_get(F_EOSC); }
+  void setRunning(bool running) { _set(F_EOSC, running ? 0 : 0xff); }
 
-  bool getINTCN();
-  void setINTCN(bool intcn);
+  // oscillator stop flag, see getTimeChecked()
+  bool getOSF() { return _get(F_OSF); }
+  void clearOSF() { _set(F_OSF, 0); }
 
-  bool getBBSQW();
-  void setBBSQW(bool bbsqw);
+  bool getINTCN() { return _get(F_INTCN); }
+  void setINTCN(bool intcn) { _set(F_INTCN, intcn ? 0xff : 0); }
 
-  SqWaveFreq getSQWFreq();
-  void setSQWFreq(SqWaveFreq freq);
+  bool getBBSQW() { return _get(F_BBSQW); }
+  void setBBSQW(bool bbsqw) { _set(F_BBSQW, bbsqw ? 0xff : 0); }
 
-  bool isIntrEnabled();
-  void setIntrEnabled(bool enabled);
+  SqWaveFreq getSQWFreq() { return static_cast<SqWaveFreq>(_get(F_RS)); }
+  void setSQWFreq(SqWaveFreq freq) { _set(F_RS, freq); }
+
+  // 32kHz pin, EN32kHz in STATUS
+  bool get32kHzOut() { return _get(F_EN32KHZ); }
+  void set32kHzOut(bool enabled);
+
+  bool isIntrEnabled() { return _get(F_INTCN); }
+  void setIntrEnabled(bool enabled) { _set(F_INTCN, enabled ? 0xff : 0); }
 
   Alarm1Rate getAL1(tm *timeptr);
   void setAL1(Alarm1Rate rate, const tm *timeptr);
-  bool isAL1IntrEnabled();
-  void setAL1IntrEnabled(bool enabled);
-  bool getAL1IntrFlag();
-  void clearAL1IntrFlag();
+  bool isAL1IntrEnabled() { return _get(F_A1IE); }
+  void setAL1IntrEnabled(bool enabled) { _set(F_A1IE, enabled ? 0xff : 0); }
+  bool getAL1IntrFlag() { return _get(F_A1F); }
+  void clearAL1IntrFlag() { _set(F_A1F, 0); }
 
   Alarm2Rate getAL2(tm *timeptr);
   void setAL2(Alarm2Rate rate, const tm *timeptr);
-  bool isAL2IntrEnabled();
-  void setAL2IntrEnabled(bool enabled);
-  bool getAL2IntrFlag();
-  void clearAL2IntrFlag();
+  bool isAL2IntrEnabled() { return _get(F_A2IE); }
+  void setAL2IntrEnabled(bool enabled) { _set(F_A2IE, enabled ? 0xff : 0); }
+  bool getAL2IntrFlag() { return _get(F_A2F); }
+  void clearAL2IntrFlag() { _set(F_A2F, 0); }
+
+  // STATUS flag bits, as returned by serviceInterrupts()
+  enum IntrSource : uint8_t {
+    INTR_AL1 = 0x01,
+    INTR_AL2 = 0x02,
+  };
+
+  using IntrHandler = void (*)(void *ctx);
+  struct IntrHandlers {
+    IntrHandler alarm1;
+    IntrHandler alarm2;
+    void *ctx;
+  };
+
+  // INT handling in two transactions: reads STATUS once, clears the flags
+  // that have a handler with one write that leaves flags raised since alone,
+  // then calls those handlers. Flags without a handler stay set. Returns the
+  // flags found.
+  uint8_t serviceInterrupts(const IntrHandlers &handlers);
+
+  // sets both alarms and their interrupt enables (with INTCN) in one burst;
+  // an *_INVALID rate leaves that alarm alone and disables its interrupt
+  void setAlarms(Alarm1Rate rate1, const tm *al1, Alarm2Rate rate2, const tm *al2);
+
+  // reads SEC..CTRL in one burst and writes back only the differing spans
+  bool configure(const Config &cfg);
 
   int8_t getAgingOffset();
   void setAgingOffset(int8_t offset);
 
   float getTemperature();
+  // in 0.25 degC units, no floating point involved
+  int16_t getTemperatureQ();
+  // Sets CONV to start a temperature conversion (and TCXO update) now.
+  // Returns false if the chip is busy with its own conversion; retry later.
+  bool startTempConv();
+  // CONV clears itself once the new value is in TEMP_MSB/TEMP_LSB
+  bool isTempConvDone();
+};
+
+// Cached DS3231 temperature with running statistics, all in 0.25 degC units.
+// request() and poll() never wait on the chip:
+//
+//   therm.request();
+//   ...
+//   if (therm.poll()) { use(therm.value()); }
+class DS3231Thermometer {
+  DS3231 &_rtc;
+  int16_t _value;
+  uint32_t _stamp;
+  int16_t _min;
+  int16_t _max;
+  int32_t _sum;
+  uint16_t _count;
+  bool _pending;
+
+  void _record(int16_t value);
+
+public:
+  explicit DS3231Thermometer(DS3231 &rtc);
+
+  // forces a conversion; false if the chip is busy, try again later
+  bool request();
+  // true once a requested conversion finished and its value was recorded
+  bool poll();
+  // records the value of the last conversion (the chip runs one every 64 s)
+  int16_t update();
+
+  bool isPending() const { return _pending; }
+  // last recorded value and its millis() timestamp
+  int16_t value() const { return _value; }
+  uint32_t timestamp() const { return _stamp; }
+
+  int16_t minValue() const { return _min; }
+  int16_t maxValue() const { return _max; }
+  int16_t meanValue() const { return _count ? _sum / _count : 0; }
+  uint16_t samples() const { return _count; }
+  void resetStats();
+};
+
+// Sub-second timestamps from the DS3231 32kHz output. The pin drives a
+// timer/counter input on the MCU; the counter is read through a hook that
+// returns a free-running edge count (extended to 32 bits by the caller).
+// anchor() ties a count to an RTC second boundary, after which now() needs
+// no bus traffic at all and resolves 1/32768 s (~30 us) at TCXO accuracy.
+// now() must be called at least once every 36 hours to follow counter wrap.
+class DS3231Timebase {
+public:
+  using CounterFn = uint32_t (*)(void *ctx);
+
+  static constexpr uint16_t TICKS_PER_SEC = 32768;
+
+  struct Timestamp {
+    // seconds since 2000-01-01 00:00:00, as RawTime::toY2KSeconds()
+    uint32_t seconds;
+    // 1/32768 s since that second began
+    uint16_t ticks;
+
+    uint32_t micros() const { return (uint32_t(ticks) * 15625) >> 9; }
+  };
+
+  DS3231Timebase(DS3231 &rtc, CounterFn counter, void *ctx = nullptr);
+
+  // enables the 32kHz output and anchors
+  bool begin(uint16_t timeout = 1100);
+  // Waits (up to timeout ms) for the seconds register to tick and records
+  // the counter at that moment, to within the bus time of one register read.
+  bool anchor(uint16_t timeout = 1100);
+  bool isAnchored() const { return _anchored; }
+
+  Timestamp now();
+
+private:
+  DS3231 &_rtc;
+  CounterFn _counter;
+  void *_ctx;
+  uint32_t _anchorCount;
+  uint32_t _anchorSecs;
+  bool _anchored;
 };
 
 // RX8025T: only basic timekeeping functions are stable
 // other functions are subject to change
 class RX8025T {
+  using RAMRef = __rtclib_details::RAMRef<RX8025T>;
+  using RAMPtr = __rtclib_details::RAMPtr<RX8025T>;
+
   TwoWire &_wire;
 
+  // control bits, register << 8 | mask
+  enum Field : uint16_t {
+    F_USEL = 0x0d20, // EXT
+    F_UF = 0x0e20,   // FLAG
+    F_TF = 0x0e10,
+    F_AF = 0x0e08,
+    F_VLF = 0x0e02,
+    F_VDET = 0x0e01,
+    F_CSEL = 0x0fc0, // CTRL
+    F_TIE = 0x0f10,
+    F_AIE = 0x0f08,
+    F_RESET = 0x0f01,
+  };
+
+  uint8_t _get(Field f) { return __rtclib_details::i2c_get_bits(_wire, ADDRESS, f); }
+  void _set(Field f, uint8_t val) { __rtclib_details::i2c_set_bits(_wire, ADDRESS, f, val); }
+
 public:
   enum TempCompIntv : uint8_t {
     TC_0S5 = 0x00,
@@ -300,6 +862,25 @@ public:
   };
 
   static constexpr uint8_t ADDRESS = 0x32;
+  // the RAM register, as a region like the DS1302/DS1307 RAM
+  static constexpr uint8_t RAM_SIZE = 1;
+
+  // Desired state of SEC..CTRL, applied by configure(). Defaults match what
+  // setup() initializes the chip to.
+  struct Config {
+    const tm *time = nullptr; // nullptr keeps the current time
+    int16_t ram = -1; // -1 keeps RAM
+    const tm *alarm = nullptr; // nullptr keeps the alarm registers, see setAlarm()
+    int16_t timer = -1; // -1 keeps the timer preset
+    TimerFreq timerFreq = TF_OFF;
+    FOUTFreq fout = FOUT_32768HZ;
+    bool usel = false;
+    TempCompIntv tempComp = TC_2S;
+    bool updateIntr = false;
+    bool timerIntr = false;
+    bool alarmIntr = false;
+    bool running = true;
+  };
 
   explicit RX8025T(TwoWire &wire = Wire);
 
@@ -310,49 +891,106 @@ public:
 
   void getTime(tm *timeptr);
   void setTime(const tm *timeptr);
+  RawTime getRawTime();
+  TimeStatus getTimeChecked(tm *timeptr);
+  TimeStatus getRawTimeChecked(RawTime *raw);
 
-  bool isRunning();
-  void setRunning(bool running);
+  bool isRunning() { return !_get(F_RESET); }
+  void setRunning(bool running) { _set(F_RESET, running ? 0 : 0xff); }
 
-  TempCompIntv getTempCompInterval();
-  void setTempCompIntv(TempCompIntv interval);
+  TempCompIntv getTempCompInterval() { return static_cast<TempCompIntv>(_get(F_CSEL)); }
+  void setTempCompIntv(TempCompIntv interval) { _set(F_CSEL, interval); }
 
   uint8_t getRAM();
   void setRAM(uint8_t val);
+  uint8_t readRAM(uint8_t index) { return index < RAM_SIZE ? getRAM() : 0; }
+  void writeRAM(uint8_t index, uint8_t val) {
+    if (index < RAM_SIZE) {
+      setRAM(val);
+    }
+  }
+  void readRAM(uint8_t index, uint8_t *buf, uint8_t len) {
+    if (index < RAM_SIZE && len > 0) {
+      *buf = getRAM();
+    }
+  }
+  void writeRAM(uint8_t index, const uint8_t *buf, uint8_t len) {
+    if (index < RAM_SIZE && len > 0) {
+      setRAM(*buf);
+    }
+  }
+  RAMPtr begin() { return RAMPtr(this, 0); }
+  RAMPtr end() { return RAMPtr(this, RAM_SIZE); }
+  RAMRef operator[](int index) { return RAMRef(this, index); }
 
   uint16_t getTimer();
   void setTimer(uint16_t val);
   TimerFreq getTimerFreq();
   void setTimerFreq(TimerFreq freq);
-  bool isTimerIntrEnabled();
-  void setTimerIntrEnabled(bool enabled);
-  bool getTimerFlag();
-  void clearTimerFlag();
+  bool isTimerIntrEnabled() { return _get(F_TIE); }
+  void setTimerIntrEnabled(bool enabled) { _set(F_TIE, enabled ? 0xff : 0); }
+  bool getTimerFlag() { return _get(F_TF); }
+  void clearTimerFlag() { _set(F_TF, 0); }
 
   FOUTFreq getFOUT();
   void setFOUT(FOUTFreq freq);
 
-  bool getVLF();
-  void clearVLF();
-  bool getVDET();
-  void clearVDET();
-  bool getUpdateFlag();
-  void clearUpdateFlag();
-  bool getUSEL();
-  void setUSEL(bool usel);
+  bool getVLF() { return _get(F_VLF); }
+  void clearVLF() { _set(F_VLF, 0); }
+  bool getVDET() { return _get(F_VDET); }
+  void clearVDET() { _set(F_VDET, 0); }
+  bool getUpdateFlag() { return _get(F_UF); }
+  void clearUpdateFlag() { _set(F_UF, 0); }
+  bool getUSEL() { return _get(F_USEL); }
+  void setUSEL(bool usel) { _set(F_USEL, usel ? 0xff : 0); }
 
   // alarm api is subject to change
   void getAlarm(tm *timeptr);
   void setAlarm(const tm *timeptr);
-  bool isAlarmIntrEnabled();
-  void setAlarmIntrEnabled(bool enabled);
-  bool getAlarmFlag();
-  void clearAlarmFlag();
+  bool isAlarmIntrEnabled() { return _get(F_AIE); }
+  void setAlarmIntrEnabled(bool enabled) { _set(F_AIE, enabled ? 0xff : 0); }
+  bool getAlarmFlag() { return _get(F_AF); }
+  void clearAlarmFlag() { _set(F_AF, 0); }
+
+  // FLAG bits, as returned by serviceInterrupts()
+  enum IntrSource : uint8_t {
+    INTR_ALARM = 0x08,
+    INTR_TIMER = 0x10,
+    INTR_UPDATE = 0x20,
+  };
+
+  using IntrHandler = void (*)(void *ctx);
+  struct IntrHandlers {
+    IntrHandler alarm;
+    IntrHandler timer;
+    IntrHandler update;
+    void *ctx;
+  };
+
+  // Same as DS3231::serviceInterrupts(), over FLAG. VLF and VDET are left
+  // alone.
+  uint8_t serviceInterrupts(const IntrHandlers &handlers);
+
+  // reads SEC..CTRL in one burst and writes back only the differing spans
+  bool configure(const Config &cfg);
 };
 
 class PCF8563 {
   TwoWire &_wire;
 
+  // control bits, register << 8 | mask
+  enum Field : uint16_t {
+    F_STOP = 0x0020,  // CTRL_1
+    F_TI_TP = 0x0110, // CTRL_2
+    F_AF = 0x0108,
+    F_TF = 0x0104,
+    F_AIE = 0x0102,
+    F_TIE = 0x0101,
+  };
+
+  uint8_t _get(Field f) { return __rtclib_details::i2c_get_bits(_wire, ADDRESS, f); }
+  void _set(Field f, uint8_t val) { __rtclib_details::i2c_set_bits(_wire, ADDRESS, f, val); }
+
 public:
   enum CLKFreq : uint8_t {
     CLKOUT_OFF = 0x00,
@@ -372,6 +1010,20 @@ public:
 
   static constexpr uint8_t ADDRESS = 0x51;
 
+  // Desired state of CTRL_1..TIM, applied by configure(). Defaults match
+  // what setup() initializes the chip to.
+  struct Config {
+    const tm *time = nullptr; // nullptr keeps the current time
+    const tm *alarm = nullptr; // nullptr keeps the alarm registers, see setAlarm()
+    int16_t timer = -1; // -1 keeps the timer value
+    TimerFreq timerFreq = TF_OFF;
+    CLKFreq clkout = CLKOUT_32768HZ;
+    bool timerPulse = false;
+    bool timerIntr = false;
+    bool alarmIntr = false;
+    bool running = true;
+  };
+
   explicit PCF8563(TwoWire &wire = Wire);
 
   bool setup();
@@ -381,9 +1033,12 @@ public:
 
   void getTime(tm *timeptr);
   void setTime(const tm *timeptr);
+  RawTime getRawTime();
+  TimeStatus getTimeChecked(tm *timeptr);
+  TimeStatus getRawTimeChecked(RawTime *raw);
 
-  bool isRunning();
-  void setRunning(bool running);
+  bool isRunning() { return !_get(F_STOP); }
+  void setRunning(bool running) { _set(F_STOP, running ? 0 : 0xff); }
 
   CLKFreq getCLKOut();
   void setCLKOut(CLKFreq freq);
@@ -392,19 +1047,189 @@ public:
   void setTimer(uint8_t val);
   TimerFreq getTimerFreq();
   void setTimerFreq(TimerFreq freq);
-  bool isTimerIntrEnabled();
-  void setTimerIntrEnabled(bool enabled);
-  bool getTimerFlag();
-  void clearTimerFlag();
-  bool isTimerPulseMode();
-  void setTimerPulseMode(bool pulse_mode);
+  bool isTimerIntrEnabled() { return _get(F_TIE); }
+  void setTimerIntrEnabled(bool enabled) { _set(F_TIE, enabled ? 0xff : 0); }
+  bool getTimerFlag() { return _get(F_TF); }
+  void clearTimerFlag() { _set(F_TF, 0); }
+  bool isTimerPulseMode() { return _get(F_TI_TP); }
+  void setTimerPulseMode(bool pulse_mode) { _set(F_TI_TP, pulse_mode ? 0xff : 0); }
 
   void getAlarm(tm *timeptr);
   void setAlarm(const tm *timeptr);
-  bool isAlarmIntrEnabled();
-  void setAlarmIntrEnabled(bool enabled);
-  bool getAlarmFlag();
-  void clearAlarmFlag();
+  bool isAlarmIntrEnabled() { return _get(F_AIE); }
+  void setAlarmIntrEnabled(bool enabled) { _set(F_AIE, enabled ? 0xff : 0); }
+  bool getAlarmFlag() { return _get(F_AF); }
+  void clearAlarmFlag() { _set(F_AF, 0); }
+
+  // CTRL_2 flag bits, as returned by serviceInterrupts()
+  enum IntrSource : uint8_t {
+    INTR_TIMER = 0x04,
+    INTR_ALARM = 0x08,
+  };
+
+  using IntrHandler = void (*)(void *ctx);
+  struct IntrHandlers {
+    IntrHandler alarm;
+    IntrHandler timer;
+    void *ctx;
+  };
+
+  // Same as DS3231::serviceInterrupts(), over CTRL_2
+  uint8_t serviceInterrupts(const IntrHandlers &handlers);
+
+  // reads CTRL_1..TIM in one burst and writes back only the differing spans
+  bool configure(const Config &cfg);
+
+  // Sub-second mode, see PCF8563SubSecond: the timer counts down from 64 at
+  // 64 Hz and reloads, i.e. wraps once a second in fixed phase to the
+  // seconds rollover. The timer interrupt, if enabled, fires every second.
+  void startSubSecTimer();
+  // time plus the current countdown value, in one burst from TIM wrapping
+  // around to YEAR
+  RawTime getRawTime(uint8_t *timer);
+};
+
+// Millisecond timestamps (at 1/64 s steps) from a PCF8563 in sub-second
+// mode. sync() finds the countdown value at the seconds rollover; after
+// that, every now() is a single bus read.
+class PCF8563SubSecond {
+  PCF8563 &_rtc;
+  uint8_t _phase;
+  bool _synced;
+
+public:
+  explicit PCF8563SubSecond(PCF8563 &rtc);
+
+  // starts the timer and syncs
+  bool begin(uint16_t timeout = 1100);
+  // polls for a seconds rollover, up to timeout ms
+  bool sync(uint16_t timeout = 1100);
+  bool isSynced() const { return _synced; }
+
+  // *ms is 0..984, in steps of 15.625
+  RawTime now(uint16_t *ms);
+};
+
+// What detectRTC() found, a bit per RawTime::Chip. DS1307 and DS3231 share
+// 0x68, so at most one of them is reported.
+struct DetectedRTC {
+  uint8_t chips;
+  // chips found whose time registers are out of range, e.g. an RX8025T or
+  // PCF8563 after its first power-up
+  uint8_t badTime;
+
+  bool has(RawTime::Chip chip) const { return chips & (1 << chip); }
+  bool empty() const { return chips == 0; }
+  bool hasValidTime(RawTime::Chip chip) const { return has(chip) && !(badTime & (1 << chip)); }
+  // the most accurate clock found: DS3231, RX8025T, PCF8563, then DS1307
+  bool best(RawTime::Chip *chip) const;
+};
+
+// Looks for the I2C chips with one read burst per address (0x68, 0x32,
+// 0x51; a DS1307 takes two) and writes nothing. A chip is recognized by its
+// control registers: reserved bits clear, and the register pointer wrapping
+// where that chip's register file ends, which tells a DS3231 (wraps after
+// 0x12) from a DS1307 (RAM up to 0x3f) and from other parts at the same
+// addresses. Whether the time itself is valid is reported separately.
+//
+//   RawTime::Chip chip;
+//   if (detectRTC().best(&chip) && chip == RawTime::CHIP_DS3231) {
+//     static DS3231 rtc;
+//     ...
+//   }
+DetectedRTC detectRTC(TwoWire &wire = Wire);
+
+// Decodes n consecutive 7-byte register blocks of `chip`, laid out like
+// RawTime::regs, into time_t. Meant for host-side ingestion of logged
+// blocks; picks an AVX2 or SSE2 kernel at runtime on x86.
+void decodeTimeBlocks(const uint8_t *blocks, size_t n, time_t *out, RawTime::Chip chip);
+
+// SdFat file timestamp callback backed by getRawTime(), e.g.
+//   SdFatClock<DS3231>::rtc = &rtc;
+//   FsDateTime::setCallback(SdFatClock<DS3231>::dateTime);
+template <typename RTC>
+struct SdFatClock {
+  static RTC *rtc;
+
+  static void dateTime(uint16_t *date, uint16_t *time) {
+    PackedTime now = rtc->getRawTime().toPacked();
+    *date = now.fatDate();
+    *time = now.fatTime();
+  }
+
+  // variant with the 10 ms field that restores the odd second
+  static void dateTimeMs10(uint16_t *date, uint16_t *time, uint8_t *ms10) {
+    PackedTime now = rtc->getRawTime().toPacked();
+    *date = now.fatDate();
+    *time = now.fatTime();
+    *ms10 = (now.second() & 1) ? 100 : 0;
+  }
+};
+
+template <typename RTC>
+RTC *SdFatClock<RTC>::rtc = nullptr;
+
+// One daylight saving change: the given weekday of a month at a local wall
+// clock hour, as read before the change. week is 1-4, or 5 for the last.
+struct DSTRule {
+  uint8_t month;
+  uint8_t week;
+  uint8_t wday;
+  uint8_t hour;
+  // minutes east of UTC from this change on
+  int16_t offset;
+};
+
+// Local time for RTCs kept in UTC. Both changes of a year are worked out
+// once, the first time that year is seen; after that a conversion is a
+// compare and an add, and toTm() redoes the date only when the local day
+// changes:
+//
+//   // Central Europe: CEST from last Sunday of March 02:00, CET from last
+//   // Sunday of October 03:00
+//   TimeZone tz({3, 5, 0, 2, 120}, {10, 5, 0, 3, 60});
+//   tm t;
+//   tz.getTime(rtc, &t);
+//
+// Times are seconds since 2000 like RawTime::toY2KSeconds(), local times
+// before 2000 are out of range.
+class TimeZone {
+  DSTRule _dst;
+  DSTRule _std;
+  bool _hasDST;
+
+  // UTC of both changes in _year, and of the bounds of _year
+  uint16_t _year;
+  uint32_t _yearStart;
+  uint32_t _yearEnd;
+  uint32_t _dstStart;
+  uint32_t _dstEnd;
+
+  // local date last handed out by toTm()
+  uint32_t _dayStart;
+  tm _day;
+
+  void _loadYear(uint32_t utc);
+  uint32_t _change(uint16_t year, const DSTRule &rule, int16_t before) const;
+
+public:
+  // fixed offset, in minutes east of UTC
+  explicit TimeZone(int16_t offset);
+  TimeZone(const DSTRule &dst, const DSTRule &std);
+
+  bool isDST(uint32_t utc);
+  // seconds to add to UTC
+  int32_t offset(uint32_t utc) { return (isDST(utc) ? _dst.offset : _std.offset) * 60L; }
+  uint32_t toLocal(uint32_t utc) { return utc + offset(utc); }
+
+  // broken-down local time, tm_isdst and tm_yday included
+  void toTm(uint32_t utc, tm *timeptr);
+  void toTm(const RawTime &raw, tm *timeptr) { toTm(raw.toY2KSeconds(), timeptr); }
+
+  template <typename RTC>
+  void getTime(RTC &rtc, tm *timeptr) {
+    toTm(rtc.getRawTime(), timeptr);
+  }
 };
 
 #endif
@@ -0,0 +1,239 @@
+#include "RTClib.h"
+
+#include <string.h>
+
+// Bulk decoding of logged time register blocks, meant for host-side
+// ingestion. Blocks are 7 bytes each, exactly as returned in RawTime::regs.
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define RTCLIB_BATCH_X86
+#include <immintrin.h>
+#endif
+
+using __rtclib_details::y2k_epoch;
+
+namespace {
+  // Where the chip keeps mday and month within bytes 3..6 of a block, as bit
+  // offsets into the little-endian word loaded from byte 3. Weekday has no
+  // bearing on the epoch and is not decoded.
+  struct BlockLayout {
+    int mdayShift;
+    int monShift;
+    uint32_t centuryMask;
+  };
+
+  BlockLayout layout_of(RawTime::Chip chip) {
+    switch (chip) {
+      case RawTime::CHIP_DS1302:
+        return BlockLayout {0, 8, 0};
+      case RawTime::CHIP_PCF8563:
+        return BlockLayout {0, 16, 0x80};
+      case RawTime::CHIP_DS3231:
+        return BlockLayout {8, 16, 0x80};
+      default:
+        return BlockLayout {8, 16, 0};
+    }
+  }
+} // namespace
+
+static void decode_scalar(const uint8_t *blocks, size_t n, time_t *out, RawTime::Chip chip) {
+  RawTime raw;
+  raw.chip = chip;
+
+  for (size_t i = 0; i < n; ++i) {
+    memcpy(raw.regs, blocks + 7 * i, sizeof(raw.regs));
+    out[i] = raw.toEpoch();
+  }
+}
+
+#ifdef RTCLIB_BATCH_X86
+// Both kernels work on 32-bit lanes without divisions: the calendar only
+// has to cover 2000..2199, where 2100 is the sole non-leap multiple of 4,
+// and the days before each month are 31 * (m - 1) minus a correction that
+// steps up at months 3, 5, 7, 10 and 12. SSE2 has no 32-bit multiply, so
+// that kernel builds the constant products from shifts and adds.
+
+#ifdef __SSE2__
+static inline __m128i bcd2bin_sse2(__m128i x) {
+  __m128i hi = _mm_srli_epi32(x, 4);
+  return _mm_sub_epi32(_mm_sub_epi32(x, _mm_slli_epi32(hi, 2)), _mm_slli_epi32(hi, 1));
+}
+
+static size_t decode_sse2(const uint8_t *blocks, size_t n, time_t *out, const BlockLayout &l) {
+  const __m128i mdayShift = _mm_cvtsi32_si128(l.mdayShift);
+  const __m128i monShift = _mm_cvtsi32_si128(l.monShift);
+  const __m128i centuryMask = _mm_set1_epi32(l.centuryMask);
+  const __m128i m7f = _mm_set1_epi32(0x7f);
+  const __m128i m3f = _mm_set1_epi32(0x3f);
+  const __m128i m1f = _mm_set1_epi32(0x1f);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi32(1);
+
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    uint32_t w0[4], w1[4];
+    for (int k = 0; k < 4; ++k) {
+      memcpy(&w0[k], blocks + 7 * (i + k), 4);
+      memcpy(&w1[k], blocks + 7 * (i + k) + 3, 4);
+    }
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(w0));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(w1));
+
+    __m128i sec = bcd2bin_sse2(_mm_and_si128(a, m7f));
+    __m128i min = bcd2bin_sse2(_mm_and_si128(_mm_srli_epi32(a, 8), m7f));
+    __m128i hour = bcd2bin_sse2(_mm_and_si128(_mm_srli_epi32(a, 16), m3f));
+    __m128i mday = bcd2bin_sse2(_mm_and_si128(_mm_srl_epi32(b, mdayShift), m3f));
+    __m128i monb = _mm_srl_epi32(b, monShift);
+    __m128i mon = bcd2bin_sse2(_mm_and_si128(monb, m1f));
+    __m128i noCentury = _mm_cmpeq_epi32(_mm_and_si128(monb, centuryMask), zero);
+    __m128i year = _mm_add_epi32(bcd2bin_sse2(_mm_srli_epi32(b, 24)), _mm_andnot_si128(noCentury, _mm_set1_epi32(100)));
+
+    // year * 365 + leap days before the year
+    __m128i days = _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(year, 8), _mm_slli_epi32(year, 6)),
+                                 _mm_add_epi32(_mm_slli_epi32(year, 5), _mm_slli_epi32(year, 3)));
+    days = _mm_add_epi32(days, _mm_add_epi32(_mm_slli_epi32(year, 2), year));
+    days = _mm_add_epi32(days, _mm_srli_epi32(_mm_add_epi32(year, _mm_set1_epi32(3)), 2));
+    days = _mm_add_epi32(days, _mm_cmpgt_epi32(year, _mm_set1_epi32(100)));
+
+    // days before the month
+    __m128i mm = _mm_sub_epi32(mon, one);
+    __m128i after_feb = _mm_cmpgt_epi32(mon, _mm_set1_epi32(2));
+    days = _mm_add_epi32(days, _mm_sub_epi32(_mm_slli_epi32(mm, 5), mm));
+    days = _mm_sub_epi32(days, _mm_and_si128(after_feb, _mm_set1_epi32(3)));
+    days = _mm_add_epi32(days, _mm_cmpgt_epi32(mon, _mm_set1_epi32(4)));
+    days = _mm_add_epi32(days, _mm_cmpgt_epi32(mon, _mm_set1_epi32(6)));
+    days = _mm_add_epi32(days, _mm_cmpgt_epi32(mon, _mm_set1_epi32(9)));
+    days = _mm_add_epi32(days, _mm_cmpgt_epi32(mon, _mm_set1_epi32(11)));
+    __m128i leap = _mm_andnot_si128(_mm_cmpeq_epi32(year, _mm_set1_epi32(100)),
+                                    _mm_cmpeq_epi32(_mm_and_si128(year, _mm_set1_epi32(3)), zero));
+    days = _mm_sub_epi32(days, _mm_and_si128(leap, after_feb));
+
+    days = _mm_add_epi32(days, _mm_sub_epi32(mday, one));
+
+    // hour * 3600 + min * 60 + sec
+    __m128i sod = _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(hour, 11), _mm_slli_epi32(hour, 10)),
+                                _mm_add_epi32(_mm_slli_epi32(hour, 9), _mm_slli_epi32(hour, 4)));
+    sod = _mm_add_epi32(sod, _mm_sub_epi32(_mm_slli_epi32(min, 6), _mm_slli_epi32(min, 2)));
+    sod = _mm_add_epi32(sod, sec);
+
+    // days * 86400 would overflow 32 bits after 2136, combine at time_t width
+    uint32_t d[4], s[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(d), days);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(s), sod);
+    for (int k = 0; k < 4; ++k) {
+      out[i + k] = y2k_epoch + static_cast<time_t>(d[k]) * 86400 + s[k];
+    }
+  }
+
+  return i;
+}
+#endif
+
+__attribute__((target("avx2"))) static inline __m256i bcd2bin_avx2(__m256i x) {
+  __m256i hi = _mm256_srli_epi32(x, 4);
+  return _mm256_sub_epi32(_mm256_sub_epi32(x, _mm256_slli_epi32(hi, 2)), _mm256_slli_epi32(hi, 1));
+}
+
+__attribute__((target("avx2"))) static size_t decode_avx2(const uint8_t *blocks, size_t n, time_t *out,
+                                                          const BlockLayout &l) {
+  const __m256i offsets = _mm256_setr_epi32(0, 7, 14, 21, 28, 35, 42, 49);
+  const __m256i mdayShift = _mm256_set1_epi32(l.mdayShift);
+  const __m256i monShift = _mm256_set1_epi32(l.monShift);
+  const __m256i centuryMask = _mm256_set1_epi32(l.centuryMask);
+  const __m256i m7f = _mm256_set1_epi32(0x7f);
+  const __m256i m3f = _mm256_set1_epi32(0x3f);
+  const __m256i m1f = _mm256_set1_epi32(0x1f);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi32(1);
+
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    // bytes 0..3 and 3..6 of each block, never reading past the last block
+    __m256i a = _mm256_i32gather_epi32(reinterpret_cast<const int *>(blocks + 7 * i), offsets, 1);
+    __m256i b = _mm256_i32gather_epi32(reinterpret_cast<const int *>(blocks + 7 * i + 3), offsets, 1);
+
+    __m256i sec = bcd2bin_avx2(_mm256_and_si256(a, m7f));
+    __m256i min = bcd2bin_avx2(_mm256_and_si256(_mm256_srli_epi32(a, 8), m7f));
+    __m256i hour = bcd2bin_avx2(_mm256_and_si256(_mm256_srli_epi32(a, 16), m3f));
+    __m256i mday = bcd2bin_avx2(_mm256_and_si256(_mm256_srlv_epi32(b, mdayShift), m3f));
+    __m256i monb = _mm256_srlv_epi32(b, monShift);
+    __m256i mon = bcd2bin_avx2(_mm256_and_si256(monb, m1f));
+    __m256i noCentury = _mm256_cmpeq_epi32(_mm256_and_si256(monb, centuryMask), zero);
+    __m256i year =
+        _mm256_add_epi32(bcd2bin_avx2(_mm256_srli_epi32(b, 24)), _mm256_andnot_si256(noCentury, _mm256_set1_epi32(100)));
+
+    __m256i days = _mm256_mullo_epi32(year, _mm256_set1_epi32(365));
+    days = _mm256_add_epi32(days, _mm256_srli_epi32(_mm256_add_epi32(year, _mm256_set1_epi32(3)), 2));
+    days = _mm256_add_epi32(days, _mm256_cmpgt_epi32(year, _mm256_set1_epi32(100)));
+
+    __m256i mm = _mm256_sub_epi32(mon, one);
+    __m256i after_feb = _mm256_cmpgt_epi32(mon, _mm256_set1_epi32(2));
+    days = _mm256_add_epi32(days, _mm256_sub_epi32(_mm256_slli_epi32(mm, 5), mm));
+    days = _mm256_sub_epi32(days, _mm256_and_si256(after_feb, _mm256_set1_epi32(3)));
+    days = _mm256_add_epi32(days, _mm256_cmpgt_epi32(mon, _mm256_set1_epi32(4)));
+    days = _mm256_add_epi32(days, _mm256_cmpgt_epi32(mon, _mm256_set1_epi32(6)));
+    days = _mm256_add_epi32(days, _mm256_cmpgt_epi32(mon, _mm256_set1_epi32(9)));
+    days = _mm256_add_epi32(days, _mm256_cmpgt_epi32(mon, _mm256_set1_epi32(11)));
+    __m256i leap = _mm256_andnot_si256(_mm256_cmpeq_epi32(year, _mm256_set1_epi32(100)),
+                                       _mm256_cmpeq_epi32(_mm256_and_si256(year, _mm256_set1_epi32(3)), zero));
+    days = _mm256_sub_epi32(days, _mm256_and_si256(leap, after_feb));
+
+    days = _mm256_add_epi32(days, _mm256_sub_epi32(mday, one));
+
+    __m256i sod = _mm256_mullo_epi32(hour, _mm256_set1_epi32(3600));
+    sod = _mm256_add_epi32(sod, _mm256_mullo_epi32(min, _mm256_set1_epi32(60)));
+    sod = _mm256_add_epi32(sod, sec);
+
+    if (sizeof(time_t) == 8) {
+      // days * 86400 overflows 32 bits after 2136, so finish in 64-bit lanes
+      const __m256i epoch = _mm256_set1_epi64x(y2k_epoch);
+      const __m256i spd = _mm256_set1_epi64x(86400);
+      __m256i dlo = _mm256_cvtepu32_epi64(_mm256_castsi256_si128(days));
+      __m256i dhi = _mm256_cvtepu32_epi64(_mm256_extracti128_si256(days, 1));
+      __m256i slo = _mm256_cvtepu32_epi64(_mm256_castsi256_si128(sod));
+      __m256i shi = _mm256_cvtepu32_epi64(_mm256_extracti128_si256(sod, 1));
+      __m256i lo = _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(dlo, spd), slo), epoch);
+      __m256i hi = _mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(dhi, spd), shi), epoch);
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), lo);
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i + 4), hi);
+    } else {
+      __m256i secs = _mm256_add_epi32(_mm256_mullo_epi32(days, _mm256_set1_epi32(86400)), sod);
+      uint32_t res[8];
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(res), secs);
+      for (int k = 0; k < 8; ++k) {
+        out[i + k] = y2k_epoch + res[k];
+      }
+    }
+  }
+
+  return i;
+}
+
+using KernelFn = size_t (*)(const uint8_t *, size_t, time_t *, const BlockLayout &);
+
+static KernelFn select_kernel() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return decode_avx2;
+  }
+#ifdef __SSE2__
+  return decode_sse2;
+#else
+  return nullptr;
+#endif
+}
+#endif
+
+void decodeTimeBlocks(const uint8_t *blocks, size_t n, time_t *out, RawTime::Chip chip) {
+  size_t done = 0;
+
+#ifdef RTCLIB_BATCH_X86
+  static const KernelFn kernel = select_kernel();
+  if (kernel != nullptr) {
+    done = kernel(blocks, n, out, layout_of(chip));
+  }
+#endif
+
+  // tail, or everything when there is no vector kernel
+  decode_scalar(blocks + 7 * done, n - done, out + done, chip);
+}
@@ -0,0 +1,147 @@
+#ifndef __RTCLIB_EVENTS_H__
+#define __RTCLIB_EVENTS_H__
+
+#include "RTClib.h"
+
+// Calendar timestamps for interrupts. The ISR only records micros() into a
+// lock-free single-producer/single-consumer ring; drain() later reads the
+// RTC once and converts the whole batch:
+//
+//   EventQueue<64> events;
+//   void onTrigger() { events.capture(); }
+//   ...
+//   EventQueue<64>::Timestamp ts[16];
+//   uint8_t n = events.drain(rtc, ts, 16);
+//
+// Event spacing is exact to micros(). Absolute time is that of the RTC read:
+// the RTC has no sub-second digits, so without sync() an event may be up to
+// 1 s early; after sync() the second boundary is known to the micros() drift
+// since. drain() finds the boundary by counting RTC seconds since sync(), so
+// micros() wrapping (every 71 minutes) does not disturb it, and it drops the
+// sync once the drift shows beyond 0.1 s. Events must still be drained
+// within 35 minutes of capture, before their micros() deltas overflow.
+template <uint16_t N>
+class EventQueue {
+  static_assert(N >= 2 && N <= 256 && (N & (N - 1)) == 0, "EventQueue size must be a power of two up to 256");
+
+public:
+  struct Timestamp {
+    time_t seconds;
+    uint32_t micros;
+  };
+
+  EventQueue() : _head {0}, _tail {0}, _dropped {0}, _rollUs {0}, _rollEpoch {0}, _synced {false} {}
+
+  // ISR side: records micros(), or counts a drop when full
+  void capture() { capture(micros()); }
+
+  void capture(uint32_t us) {
+    uint8_t head = _head;
+    if (static_cast<uint8_t>(head - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE)) >= N - 1) {
+      ++_dropped;
+      return;
+    }
+    _buf[head & (N - 1)] = us;
+    __atomic_store_n(&_head, static_cast<uint8_t>(head + 1), __ATOMIC_RELEASE);
+  }
+
+  uint8_t size() const { return __atomic_load_n(&_head, __ATOMIC_ACQUIRE) - _tail; }
+  // events lost to a full queue, since construction
+  uint16_t dropped() const { return _dropped; }
+
+  // Waits (up to timeout ms) for the seconds register to tick and records
+  // micros() at that moment, so that drain() knows where seconds begin.
+  template <typename RTC>
+  bool sync(RTC &rtc, uint16_t timeout = 1100) {
+    uint8_t first = rtc.getRawTime().regs[0];
+    uint32_t start = millis();
+
+    for (;;) {
+      uint32_t before = micros();
+      RawTime raw = rtc.getRawTime();
+      if (raw.regs[0] != first) {
+        _rollUs = before + (micros() - before) / 2;
+        _rollEpoch = raw.toEpoch();
+        _synced = true;
+        return true;
+      }
+      if (millis() - start > timeout) {
+        return false;
+      }
+    }
+  }
+
+  // Reads the RTC once and converts up to max queued events, oldest first.
+  // Returns the number converted.
+  template <typename RTC>
+  uint8_t drain(RTC &rtc, Timestamp *out, uint8_t max) {
+    uint8_t n = size();
+    if (n == 0) {
+      return 0;
+    }
+    if (n > max) {
+      n = max;
+    }
+
+    uint32_t before = micros();
+    RawTime raw = rtc.getRawTime();
+    uint32_t readUs = before + (micros() - before) / 2;
+
+    // micros() at which the second read above began
+    time_t epoch = raw.toEpoch();
+    uint32_t secStart = readUs;
+    if (_synced) {
+      // Whole seconds come from the RTC, not from dividing micros(), so the
+      // prediction holds across a micros() wrap: modulo 2^32 it is still a
+      // micros() value.
+      uint32_t k = static_cast<uint32_t>(epoch - _rollEpoch);
+      uint32_t predicted = _rollUs + k * 1000000UL;
+      int32_t into = static_cast<int32_t>(readUs - predicted);
+
+      if (into < -static_cast<int32_t>(MAX_DRIFT) || into >= static_cast<int32_t>(1000000UL + MAX_DRIFT)) {
+        // drifted too far, or the RTC was set since
+        _synced = false;
+      } else if (into < 0) {
+        // the rollover came early, the second began just before the read
+      } else if (into >= 1000000L) {
+        // the next rollover is late, the second began just over 1 s ago
+        secStart = readUs - 999999UL;
+      } else {
+        secStart = predicted;
+      }
+    }
+
+    for (uint8_t i = 0; i < n; ++i) {
+      int32_t delta = static_cast<int32_t>(_buf[(_tail + i) & (N - 1)] - secStart);
+      int32_t secs = delta / 1000000L;
+      int32_t us = delta % 1000000L;
+      if (us < 0) {
+        us += 1000000L;
+        --secs;
+      }
+      out[i].seconds = epoch + secs;
+      out[i].micros = us;
+    }
+
+    __atomic_store_n(&_tail, static_cast<uint8_t>(_tail + n), __ATOMIC_RELEASE);
+    return n;
+  }
+
+private:
+  // phase error tolerated before the second boundary is taken as unknown,
+  // in us; about 20 s of a 0.5% resonator, re-sync more often than that
+  static constexpr uint32_t MAX_DRIFT = 100000UL;
+
+  uint32_t _buf[N];
+  // free-running, wrap at 256 which N divides
+  uint8_t _head;
+  uint8_t _tail;
+  volatile uint16_t _dropped;
+
+  // micros() and epoch of the rollover seen by sync()
+  uint32_t _rollUs;
+  time_t _rollEpoch;
+  bool _synced;
+};
+
+#endif
@@ -0,0 +1,429 @@
+#include "RTClib_linux.h"
+
+#ifdef RTCLIB_LINUX
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+TwoWire Wire(1);
+
+static uint64_t monotonic_us() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return uint64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint32_t millis() {
+  return monotonic_us() / 1000;
+}
+
+uint32_t micros() {
+  return monotonic_us();
+}
+
+void delayMicroseconds(unsigned int us) {
+  uint64_t end = monotonic_us() + us;
+  while (monotonic_us() < end) {
+  }
+}
+
+static FakeDS1302 *fake_ds1302 = nullptr;
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (fake_ds1302 != nullptr) {
+    fake_ds1302->pinChanged(pin, val);
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  return fake_ds1302 != nullptr ? fake_ds1302->pinLevel(pin) : LOW;
+}
+
+static speed_t tty_speed(uint32_t baud) {
+  switch (baud) {
+    case 9600:
+      return B9600;
+    case 19200:
+      return B19200;
+    case 38400:
+      return B38400;
+    case 57600:
+      return B57600;
+    case 230400:
+      return B230400;
+    case 460800:
+      return B460800;
+    case 921600:
+      return B921600;
+    default:
+      return B115200;
+  }
+}
+
+Stream::Stream(int fd) : _fd {fd} {
+  if (_fd >= 0) {
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+    _configure(115200);
+  }
+}
+
+Stream::Stream(const char *path, uint32_t baud) : _fd {open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC)} {
+  if (_fd >= 0) {
+    _configure(baud);
+  }
+}
+
+Stream::~Stream() {
+  if (_fd >= 0) {
+    close(_fd);
+  }
+}
+
+void Stream::_configure(uint32_t baud) {
+  termios tio;
+  if (tcgetattr(_fd, &tio) != 0) {
+    // not a tty (pipe, socket), nothing to set
+    return;
+  }
+
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  cfsetispeed(&tio, tty_speed(baud));
+  cfsetospeed(&tio, tty_speed(baud));
+  tcsetattr(_fd, TCSANOW, &tio);
+}
+
+int Stream::available() {
+  int n = 0;
+  return ioctl(_fd, FIONREAD, &n) < 0 ? 0 : n;
+}
+
+int Stream::read() {
+  uint8_t val;
+  return ::read(_fd, &val, 1) == 1 ? val : -1;
+}
+
+size_t Stream::write(uint8_t val) {
+  return write(&val, 1);
+}
+
+size_t Stream::write(const uint8_t *buf, size_t len) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = ::write(_fd, buf + done, len - done);
+    if (n > 0) {
+      done += n;
+    } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+      break;
+    }
+  }
+  return done;
+}
+
+void Stream::flush() {
+  tcdrain(_fd);
+}
+
+static int i2cdev_transfer(void *, int fd, i2c_msg *msgs, uint32_t nmsgs) {
+  i2c_rdwr_ioctl_data data;
+  data.msgs = msgs;
+  data.nmsgs = nmsgs;
+
+  return ioctl(fd, I2C_RDWR, &data) < 0 ? -errno : 0;
+}
+
+TwoWire::TwoWire(uint8_t bus)
+    : _fd {-1}, _bus {bus}, _transfer {i2cdev_transfer}, _ctx {nullptr}, _addr {0}, _txLen {0},
+      _txOverflow {false}, _txPending {false}, _rxLen {0}, _rxPos {0} {}
+
+TwoWire::TwoWire(TransferFn fn, void *ctx)
+    : _fd {-1}, _bus {0}, _transfer {fn}, _ctx {ctx}, _addr {0}, _txLen {0}, _txOverflow {false},
+      _txPending {false}, _rxLen {0}, _rxPos {0} {}
+
+TwoWire::~TwoWire() {
+  end();
+}
+
+bool TwoWire::begin() {
+  if (_transfer != i2cdev_transfer || _fd >= 0) {
+    return true;
+  }
+
+  char path[16];
+  snprintf(path, sizeof(path), "/dev/i2c-%u", _bus);
+  _fd = open(path, O_RDWR | O_CLOEXEC);
+  return _fd >= 0;
+}
+
+void TwoWire::end() {
+  if (_fd >= 0) {
+    close(_fd);
+    _fd = -1;
+  }
+}
+
+void TwoWire::beginTransmission(uint8_t addr) {
+  _addr = addr;
+  _txLen = 0;
+  _txOverflow = false;
+  _txPending = false;
+}
+
+size_t TwoWire::write(uint8_t val) {
+  if (_txLen >= BUFFER_LENGTH) {
+    _txOverflow = true;
+    return 0;
+  }
+
+  _txBuf[_txLen++] = val;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *buf, size_t len) {
+  size_t n = 0;
+  while (n < len && write(buf[n])) {
+    ++n;
+  }
+  return n;
+}
+
+// return values follow the Arduino core:
+// 0 success, 1 data too long, 2 NACK on address, 4 other error
+static uint8_t transfer_status(int ret) {
+  switch (ret) {
+    case 0:
+      return 0;
+    case -ENXIO:
+    case -EREMOTEIO:
+      return 2;
+    default:
+      return 4;
+  }
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+  if (_txOverflow) {
+    return 1;
+  }
+
+  if (!sendStop) {
+    // repeated start: goes out together with the following requestFrom()
+    _txPending = true;
+    return 0;
+  }
+
+  return _flushPending();
+}
+
+uint8_t TwoWire::_flushPending() {
+  if (!begin()) {
+    return 4;
+  }
+
+  i2c_msg msg;
+  msg.addr = _addr;
+  msg.flags = 0;
+  msg.len = _txLen;
+  msg.buf = _txBuf;
+
+  _txPending = false;
+  _txLen = 0;
+  return transfer_status(_transfer(_ctx, _fd, &msg, 1));
+}
+
+uint8_t TwoWire::requestFrom(uint8_t addr, uint8_t len, bool) {
+  _rxLen = 0;
+  _rxPos = 0;
+
+  if (len > BUFFER_LENGTH) {
+    len = BUFFER_LENGTH;
+  }
+
+  if (!begin()) {
+    _txPending = false;
+    return 0;
+  }
+
+  i2c_msg msgs[2];
+  uint32_t n = 0;
+
+  if (_txPending && _addr == addr) {
+    // register address write + read, one transaction with repeated start
+    msgs[n].addr = addr;
+    msgs[n].flags = 0;
+    msgs[n].len = _txLen;
+    msgs[n].buf = _txBuf;
+    ++n;
+  } else if (_txPending) {
+    _flushPending();
+  }
+  _txPending = false;
+  _txLen = 0;
+
+  msgs[n].addr = addr;
+  msgs[n].flags = I2C_M_RD;
+  msgs[n].len = len;
+  msgs[n].buf = _rxBuf;
+  ++n;
+
+  if (_transfer(_ctx, _fd, msgs, n) != 0) {
+    return 0;
+  }
+
+  _rxLen = len;
+  return len;
+}
+
+int TwoWire::available() {
+  return _rxLen - _rxPos;
+}
+
+int TwoWire::read() {
+  return _rxPos < _rxLen ? _rxBuf[_rxPos++] : -1;
+}
+
+int TwoWire::peek() {
+  return _rxPos < _rxLen ? _rxBuf[_rxPos] : -1;
+}
+
+FakeI2CBus::FakeI2CBus() : _devs {}, _count {0}, _stats {} {}
+
+bool FakeI2CBus::attach(uint8_t addr, uint8_t *regs, uint8_t size) {
+  if (_count >= MAX_DEVICES || size == 0) {
+    return false;
+  }
+
+  _devs[_count++] = Device {addr, regs, size, 0};
+  return true;
+}
+
+FakeI2CBus::Device *FakeI2CBus::find(uint8_t addr) {
+  for (uint8_t i = 0; i < _count; ++i) {
+    if (_devs[i].addr == addr) {
+      return &_devs[i];
+    }
+  }
+  return nullptr;
+}
+
+int FakeI2CBus::transfer(void *ctx, int, i2c_msg *msgs, uint32_t nmsgs) {
+  FakeI2CBus *bus = static_cast<FakeI2CBus *>(ctx);
+  ++bus->_stats.transfers;
+
+  for (uint32_t i = 0; i < nmsgs; ++i) {
+    ++bus->_stats.messages;
+    Device *dev = bus->find(msgs[i].addr);
+    if (dev == nullptr) {
+      return -ENXIO;
+    }
+    (msgs[i].flags & I2C_M_RD ? bus->_stats.read : bus->_stats.written) += msgs[i].len;
+
+    uint16_t pos = 0;
+    if ((msgs[i].flags & I2C_M_RD) == 0 && msgs[i].len > 0) {
+      // first byte written is the register pointer
+      dev->pointer = msgs[i].buf[0] % dev->size;
+      pos = 1;
+    }
+
+    for (; pos < msgs[i].len; ++pos) {
+      if (msgs[i].flags & I2C_M_RD) {
+        msgs[i].buf[pos] = dev->regs[dev->pointer];
+      } else {
+        dev->regs[dev->pointer] = msgs[i].buf[pos];
+      }
+      dev->pointer = (dev->pointer + 1) % dev->size;
+    }
+  }
+
+  return 0;
+}
+
+FakeDS1302::FakeDS1302(uint8_t ce, uint8_t sck, uint8_t io)
+    : clock {}, ram {}, _ce {ce}, _sck {sck}, _io {io}, _levels {0}, _cmd {0}, _index {0}, _shift {0}, _bits {0},
+      _haveCmd {false}, _stats {} {
+  fake_ds1302 = this;
+}
+
+FakeDS1302::~FakeDS1302() {
+  if (fake_ds1302 == this) {
+    fake_ds1302 = nullptr;
+  }
+}
+
+uint8_t *FakeDS1302::_reg(uint8_t index) {
+  if (_cmd & 0x40) {
+    return &ram[index % sizeof(ram)];
+  }
+  // the clock burst covers SEC..WP
+  return &clock[((_cmd >> 1) & 0x1f) == 0x1f ? index % 8 : index % sizeof(clock)];
+}
+
+void FakeDS1302::pinChanged(uint8_t pin, uint8_t val) {
+  uint8_t bit = pin == _ce ? 1 : pin == _sck ? 2 : pin == _io ? 4 : 0;
+  bool was = _levels & bit;
+  _levels = val ? (_levels | bit) : (_levels & ~bit);
+
+  if (bit == 1 && val && !was) {
+    ++_stats.transfers;
+    _haveCmd = false;
+    _shift = 0;
+    _bits = 0;
+  } else if (bit == 2 && val && !was && (_levels & 1)) {
+    ++_stats.clocks;
+    _clock();
+  }
+}
+
+// one SCK rising edge with CE high
+void FakeDS1302::_clock() {
+  bool reading = _haveCmd && (_cmd & 0x01);
+  if (reading) {
+    // the next bit goes out on the falling edge that follows
+    if (++_bits == 8) {
+      _bits = 0;
+      ++_index;
+      ++_stats.read;
+    }
+    return;
+  }
+
+  _shift = (_shift >> 1) | ((_levels & 4) ? 0x80 : 0);
+  if (++_bits < 8) {
+    return;
+  }
+  _bits = 0;
+  ++_stats.written;
+
+  if (!_haveCmd) {
+    _cmd = _shift;
+    _haveCmd = true;
+    _index = ((_cmd >> 1) & 0x1f) == 0x1f ? 0 : (_cmd >> 1) & 0x1f;
+    return;
+  }
+
+  // WP blocks everything but writes to WP itself
+  bool wp = (clock[7] & 0x80) && !(!(_cmd & 0x40) && _index == 7);
+  if (!wp) {
+    *_reg(_index) = _shift;
+  }
+  ++_index;
+}
+
+int FakeDS1302::pinLevel(uint8_t pin) {
+  if (pin != _io || !(_levels & 1) || !_haveCmd || !(_cmd & 0x01)) {
+    return LOW;
+  }
+  return (*_reg(_index) >> _bits) & 1;
+}
+
+#endif
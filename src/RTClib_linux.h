@@ -0,0 +1,208 @@
+#ifndef __RTCLIB_LINUX_H__
+#define __RTCLIB_LINUX_H__
+
+// Linux userspace transport, used when RTClib is built outside of the Arduino
+// core (e.g. on an SBC gateway). It provides a TwoWire look-alike on top of
+// i2c-dev so that the I2C chip classes compile and behave unchanged.
+
+#if defined(__linux__) && !defined(ARDUINO)
+#define RTCLIB_LINUX
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct i2c_msg;
+
+class TwoWire {
+public:
+  // Performs one combined transfer (I2C_RDWR). Replaceable so that the chip
+  // classes can be driven without hardware, see FakeI2CBus below.
+  using TransferFn = int (*)(void *ctx, int fd, i2c_msg *msgs, uint32_t nmsgs);
+
+  // same as the AVR core, keeps host behavior identical to the target
+  static constexpr uint8_t BUFFER_LENGTH = 32;
+
+  // bus number N of /dev/i2c-N, opened lazily on first use
+  explicit TwoWire(uint8_t bus);
+  TwoWire(TransferFn fn, void *ctx);
+  ~TwoWire();
+
+  TwoWire(const TwoWire &) = delete;
+  TwoWire &operator=(const TwoWire &) = delete;
+
+  bool begin();
+  void end();
+
+  void beginTransmission(uint8_t addr);
+  size_t write(uint8_t val);
+  size_t write(const uint8_t *buf, size_t len);
+  uint8_t endTransmission(bool sendStop = true);
+
+  uint8_t requestFrom(uint8_t addr, uint8_t len, bool sendStop = true);
+  int available();
+  int read();
+  int peek();
+
+private:
+  int _fd;
+  uint8_t _bus;
+  TransferFn _transfer;
+  void *_ctx;
+
+  uint8_t _addr;
+  uint8_t _txBuf[BUFFER_LENGTH];
+  uint8_t _txLen;
+  bool _txOverflow;
+  // write held back by endTransmission(false), sent with the next read
+  bool _txPending;
+
+  uint8_t _rxBuf[BUFFER_LENGTH];
+  uint8_t _rxLen;
+  uint8_t _rxPos;
+
+  uint8_t _flushPending();
+};
+
+extern TwoWire Wire;
+
+// Arduino core time base on CLOCK_MONOTONIC, wrapping the same way
+uint32_t millis();
+uint32_t micros();
+void delayMicroseconds(unsigned int us);
+
+// Arduino pin API, as much as the bit-banged DS1302 uses. There are no real
+// pins behind it: levels go to the FakeDS1302 below, if one is attached.
+#ifndef HIGH
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x0
+#define OUTPUT 0x1
+#endif
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+// Serial port look-alike over a tty or pty, raw 8N1 and non-blocking, so
+// that code written against Arduino's Stream (e.g. TimeSyncServer) runs on
+// the host too.
+class Stream {
+public:
+  // takes over an open descriptor, which is then closed by the destructor
+  explicit Stream(int fd);
+  // opens and configures a tty; check isOpen()
+  explicit Stream(const char *path, uint32_t baud = 115200);
+  ~Stream();
+
+  Stream(const Stream &) = delete;
+  Stream &operator=(const Stream &) = delete;
+
+  bool isOpen() const { return _fd >= 0; }
+  int fd() const { return _fd; }
+
+  int available();
+  int read();
+  size_t write(uint8_t val);
+  size_t write(const uint8_t *buf, size_t len);
+  // waits until everything written has left
+  void flush();
+
+private:
+  int _fd;
+
+  void _configure(uint32_t baud);
+};
+
+// Stand-in for a real /dev/i2c-N: a set of register-file devices answering
+// I2C_RDWR transfers in memory. Writes set the register pointer and store
+// with auto-increment, reads continue from the pointer; both wrap at the end
+// of the register file like the real chips do.
+class FakeI2CBus {
+public:
+  static constexpr uint8_t MAX_DEVICES = 4;
+
+  struct Device {
+    uint8_t addr;
+    uint8_t *regs;
+    uint8_t size;
+    uint8_t pointer;
+  };
+
+  // traffic since the last resetStats()
+  struct Stats {
+    // I2C_RDWR calls, i.e. bus transactions
+    uint32_t transfers;
+    // messages, i.e. (repeated) start conditions
+    uint32_t messages;
+    // data bytes after the address byte, register pointers included
+    uint32_t written;
+    uint32_t read;
+  };
+
+  FakeI2CBus();
+
+  bool attach(uint8_t addr, uint8_t *regs, uint8_t size);
+  Device *find(uint8_t addr);
+
+  const Stats &stats() const { return _stats; }
+  void resetStats() { _stats = Stats {}; }
+
+  static int transfer(void *ctx, int fd, i2c_msg *msgs, uint32_t nmsgs);
+
+private:
+  Device _devs[MAX_DEVICES];
+  uint8_t _count;
+  Stats _stats;
+};
+
+// Stand-in for a DS1302 behind the pin API: it follows the 3-wire protocol
+// on its three pins (single and burst access to the clock registers, TC and
+// RAM, WP honored) and counts CE cycles and SCK pulses. One instance is
+// attached at a time, from construction to destruction.
+class FakeDS1302 {
+public:
+  // SEC..YEAR, WP, TC
+  uint8_t clock[9];
+  uint8_t ram[31];
+
+  // traffic since the last resetStats()
+  struct Stats {
+    // CE high periods, i.e. transfers
+    uint32_t transfers;
+    // SCK rising edges with CE high, command bytes included
+    uint32_t clocks;
+    // whole bytes shifted in (command bytes included) and out
+    uint32_t written;
+    uint32_t read;
+  };
+
+  FakeDS1302(uint8_t ce, uint8_t sck, uint8_t io);
+  ~FakeDS1302();
+
+  FakeDS1302(const FakeDS1302 &) = delete;
+  FakeDS1302 &operator=(const FakeDS1302 &) = delete;
+
+  const Stats &stats() const { return _stats; }
+  void resetStats() { _stats = Stats {}; }
+
+  // called by the pin API
+  void pinChanged(uint8_t pin, uint8_t val);
+  int pinLevel(uint8_t pin);
+
+private:
+  uint8_t _ce, _sck, _io;
+  uint8_t _levels; // bit per pin: CE, SCK, IO as driven by the host
+  uint8_t _cmd;
+  uint8_t _index;
+  uint8_t _shift;
+  uint8_t _bits;
+  bool _haveCmd;
+  Stats _stats;
+
+  uint8_t *_reg(uint8_t index);
+  void _clock();
+};
+
+#endif
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef __RTCLIB_LOCK_H__
+#define __RTCLIB_LOCK_H__
+
+// Bus lock policies. RTClib.cpp holds the lock around every logical bus
+// transaction (register address write + read, read-modify-write), so that
+// other tasks sharing the TwoWire cannot get in between. The policy is
+// chosen at build time:
+//
+//   -DRTCLIB_BUS_LOCK=NoBusLock         default, compiles to nothing
+//   -DRTCLIB_BUS_LOCK=MutexBusLock      recursive mutex
+//   -DRTCLIB_BUS_LOCK=PriorityBusLock   recursive mutex, priority inheritance
+//
+// The mutex policies exist on Linux and FreeRTOS (ESP32); on FreeRTOS both
+// are the same, since its mutexes already inherit priority and wake the
+// highest-priority waiter first. Locks are recursive, and one lock covers
+// all TwoWire instances. Use the same policy for any code of your own that
+// talks to the bus, e.g. MutexBusLock::lock().
+
+#include <stdint.h>
+
+#if defined(ESP_PLATFORM) || defined(ARDUINO_ARCH_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#define RTCLIB_LOCK_FREERTOS
+#elif defined(RTCLIB_LINUX)
+#include <mutex>
+#include <pthread.h>
+#define RTCLIB_LOCK_PTHREAD
+#endif
+
+struct BusLockStats {
+  // outermost acquisitions, and how many of them had to wait
+  uint32_t acquired;
+  uint32_t contended;
+  // time spent waiting, in us
+  uint32_t totalWait;
+  uint32_t maxWait;
+};
+
+struct NoBusLock {
+  static void lock() {}
+  static void unlock() {}
+  static BusLockStats stats() { return BusLockStats {}; }
+  static void resetStats() {}
+};
+
+#if defined(RTCLIB_LOCK_FREERTOS) || defined(RTCLIB_LOCK_PTHREAD)
+namespace __rtclib_details {
+#ifdef RTCLIB_LOCK_FREERTOS
+  class RecursiveMutex {
+    SemaphoreHandle_t _sem;
+
+  public:
+    RecursiveMutex() : _sem {xSemaphoreCreateRecursiveMutex()} {}
+    void lock() { xSemaphoreTakeRecursive(_sem, portMAX_DELAY); }
+    bool try_lock() { return xSemaphoreTakeRecursive(_sem, 0) == pdTRUE; }
+    void unlock() { xSemaphoreGiveRecursive(_sem); }
+  };
+
+  using PriorityMutex = RecursiveMutex;
+#else
+  using RecursiveMutex = std::recursive_mutex;
+
+  class PriorityMutex {
+    pthread_mutex_t _mutex;
+
+  public:
+    PriorityMutex() {
+      pthread_mutexattr_t attr;
+      pthread_mutexattr_init(&attr);
+      pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+      pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+      pthread_mutex_init(&_mutex, &attr);
+      pthread_mutexattr_destroy(&attr);
+    }
+    ~PriorityMutex() { pthread_mutex_destroy(&_mutex); }
+
+    void lock() { pthread_mutex_lock(&_mutex); }
+    bool try_lock() { return pthread_mutex_trylock(&_mutex) == 0; }
+    void unlock() { pthread_mutex_unlock(&_mutex); }
+  };
+#endif
+
+  // Wraps a recursive mutex with wait statistics. The stats and the depth
+  // are only touched by the owner, so the mutex itself protects them.
+  template <typename Mutex>
+  class CountingLock {
+    static Mutex &_mutex() {
+      static Mutex mutex;
+      return mutex;
+    }
+    static BusLockStats &_stats() {
+      static BusLockStats stats;
+      return stats;
+    }
+    static uint8_t &_depth() {
+      static uint8_t depth;
+      return depth;
+    }
+
+  public:
+    static void lock() {
+      uint32_t wait = 0;
+      bool waited = !_mutex().try_lock();
+      if (waited) {
+        uint32_t start = micros();
+        _mutex().lock();
+        wait = micros() - start;
+      }
+
+      if (_depth()++ == 0) {
+        BusLockStats &s = _stats();
+        ++s.acquired;
+        if (waited) {
+          ++s.contended;
+          s.totalWait += wait;
+          if (wait > s.maxWait) {
+            s.maxWait = wait;
+          }
+        }
+      }
+    }
+
+    static void unlock() {
+      --_depth();
+      _mutex().unlock();
+    }
+
+    static BusLockStats stats() {
+      _mutex().lock();
+      BusLockStats s = _stats();
+      _mutex().unlock();
+      return s;
+    }
+
+    static void resetStats() {
+      _mutex().lock();
+      _stats() = BusLockStats {};
+      _mutex().unlock();
+    }
+  };
+} // namespace __rtclib_details
+
+using MutexBusLock = __rtclib_details::CountingLock<__rtclib_details::RecursiveMutex>;
+using PriorityBusLock = __rtclib_details::CountingLock<__rtclib_details::PriorityMutex>;
+#endif
+
+#ifndef RTCLIB_BUS_LOCK
+#define RTCLIB_BUS_LOCK NoBusLock
+#endif
+
+namespace __rtclib_details {
+  // RAII holder of the configured policy
+  class BusLock {
+  public:
+    BusLock() { RTCLIB_BUS_LOCK::lock(); }
+    ~BusLock() { RTCLIB_BUS_LOCK::unlock(); }
+
+    BusLock(const BusLock &) = delete;
+    BusLock &operator=(const BusLock &) = delete;
+  };
+} // namespace __rtclib_details
+
+#endif
@@ -0,0 +1,279 @@
+#ifndef __RTCLIB_REDUNDANT_H__
+#define __RTCLIB_REDUNDANT_H__
+
+#include "RTClib.h"
+
+// Two or three RTCs holding the same time, e.g. a DS3231 backed by a cheaper
+// PCF8563. Reads touch only the active unit. A reading whose status is not
+// TIME_OK (see getRawTimeChecked()) or that strays from the time predicted
+// by millis() fails over to the next healthy unit within the same call. Every auditInterval ms all
+// units are read and a vote picks the winner. Reads never write: stale
+// units are only marked, and poll() re-syncs them from the winner.
+//
+//   DS3231 main;
+//   PCF8563 backup;
+//   RedundantRTC<DS3231, PCF8563> rtc(main, backup);
+//   ...
+//   rtc.getTime(&t);
+//   rtc.poll(); // from the main loop or a low-priority task
+template <typename RTC0, typename RTC1, typename RTC2 = RTC1>
+class RedundantRTC {
+public:
+  RedundantRTC(RTC0 &rtc0, RTC1 &rtc1, uint32_t auditInterval = 60000, uint8_t maxSkew = 2)
+      : _rtc0 {&rtc0}, _rtc1 {&rtc1}, _rtc2 {nullptr}, _count {2}, _maxSkew {maxSkew},
+        _auditInterval {auditInterval} {}
+
+  RedundantRTC(RTC0 &rtc0, RTC1 &rtc1, RTC2 &rtc2, uint32_t auditInterval = 60000, uint8_t maxSkew = 2)
+      : _rtc0 {&rtc0}, _rtc1 {&rtc1}, _rtc2 {&rtc2}, _count {3}, _maxSkew {maxSkew},
+        _auditInterval {auditInterval} {}
+
+  // false when no unit holds a usable time
+  bool getRawTime(RawTime *raw) {
+    if (_auditDue || millis() - _lastAudit >= _auditInterval) {
+      if (audit()) {
+        *raw = _last;
+        return true;
+      }
+    }
+
+    uint32_t now = millis();
+    for (uint8_t n = 0; n < _count; ++n) {
+      uint8_t i = (_active + n) % _count;
+      if ((_healthy & (1 << i)) == 0) {
+        continue;
+      }
+
+      RawTime r;
+      if (_read(i, &r) == TIME_OK && _acceptable(r, now)) {
+        if (i != _active) {
+          _active = i;
+          ++_failovers;
+          // let the next read find out who is wrong
+          _auditDue = true;
+        }
+        _remember(r, now);
+        *raw = r;
+        return true;
+      }
+      _healthy &= ~(1 << i);
+    }
+
+    _auditDue = true;
+    return false;
+  }
+
+  bool getTime(tm *timeptr) {
+    RawTime raw;
+    if (!getRawTime(&raw)) {
+      return false;
+    }
+    raw.toTm(timeptr);
+    return true;
+  }
+
+  // sets and restarts all units
+  void setTime(const tm *timeptr) {
+    for (uint8_t i = 0; i < _count; ++i) {
+      _resync(i, timeptr);
+    }
+    _healthy = (1 << _count) - 1;
+    _stale = 0;
+    _haveLast = false;
+  }
+
+  // Runs the audit when it is due, then re-syncs the units it found stale
+  // from a fresh reading of the active one. The writes happen here only, so
+  // that getTime() stays a read.
+  void poll() {
+    if (_auditDue || millis() - _lastAudit >= _auditInterval) {
+      audit();
+    }
+    if (_stale == 0) {
+      return;
+    }
+
+    RawTime raw;
+    if (!getRawTime(&raw)) {
+      return;
+    }
+    tm t;
+    raw.toTm(&t);
+    for (uint8_t i = 0; i < _count; ++i) {
+      if (_stale & (1 << i)) {
+        // stopped, lost power, drifted off or holding garbage; a unit that
+        // is off the bus just NACKs and gets dropped again on its next read
+        _resync(i, &t);
+        _healthy |= 1 << i;
+        ++_resyncs;
+      }
+    }
+    _stale = 0;
+  }
+
+  // Reads all units and votes; the losers are marked stale for poll(). A
+  // unit wins by the number of others within maxSkew seconds of it; ties go
+  // to the one closest to the predicted time, then to the active one.
+  // Returns false if no unit is usable at all.
+  bool audit() {
+    RawTime raws[3];
+    uint32_t secs[3];
+    uint8_t usable = 0;
+
+    uint32_t now = millis();
+    _lastAudit = now;
+    _auditDue = false;
+
+    for (uint8_t i = 0; i < _count; ++i) {
+      if (_read(i, &raws[i]) == TIME_OK) {
+        secs[i] = raws[i].toY2KSeconds();
+        usable |= 1 << i;
+      }
+    }
+
+    int8_t winner = -1;
+    uint8_t bestVotes = 0;
+    uint32_t bestError = 0;
+    for (uint8_t i = 0; i < _count; ++i) {
+      if ((usable & (1 << i)) == 0) {
+        continue;
+      }
+
+      uint8_t votes = 0;
+      for (uint8_t j = 0; j < _count; ++j) {
+        if ((usable & (1 << j)) && _distance(secs[i], secs[j]) <= _maxSkew) {
+          ++votes;
+        }
+      }
+      uint32_t error = _haveLast ? _distance(secs[i], _predict(now)) : 0;
+
+      if (winner < 0 || votes > bestVotes ||
+          (votes == bestVotes && (error < bestError || (error == bestError && i == _active)))) {
+        winner = i;
+        bestVotes = votes;
+        bestError = error;
+      }
+    }
+
+    if (winner < 0) {
+      _healthy = 0;
+      _stale = 0;
+      _auditDue = true;
+      return false;
+    }
+
+    if (winner != _active) {
+      _active = winner;
+      ++_failovers;
+    }
+    _remember(raws[winner], now);
+
+    _healthy = 0;
+    _stale = 0;
+    for (uint8_t i = 0; i < _count; ++i) {
+      if ((usable & (1 << i)) && _distance(secs[i], secs[winner]) <= _maxSkew) {
+        _healthy |= 1 << i;
+      } else {
+        _stale |= 1 << i;
+      }
+    }
+
+    return true;
+  }
+
+  // index of the unit serving reads, in constructor order
+  uint8_t active() const { return _active; }
+  // bit i set when unit i is trusted for failover
+  uint8_t healthy() const { return _healthy; }
+  // bit i set when unit i waits for poll() to re-sync it
+  uint8_t stale() const { return _stale; }
+  uint16_t failovers() const { return _failovers; }
+  uint16_t resyncs() const { return _resyncs; }
+
+private:
+  RTC0 *_rtc0;
+  RTC1 *_rtc1;
+  RTC2 *_rtc2;
+  uint8_t _count;
+  uint8_t _maxSkew;
+  uint32_t _auditInterval;
+
+  uint8_t _active = 0;
+  uint8_t _healthy = (1 << _count) - 1;
+  uint8_t _stale = 0;
+  // the first read votes before trusting anyone
+  bool _auditDue = true;
+  uint32_t _lastAudit = 0;
+  uint16_t _failovers = 0;
+  uint16_t _resyncs = 0;
+
+  // last accepted reading, to predict the next one
+  RawTime _last;
+  uint32_t _lastSecs = 0;
+  uint32_t _lastMillis = 0;
+  bool _haveLast = false;
+
+  // the flags come in the same read as the time, OSF and VLF included
+  TimeStatus _read(uint8_t i, RawTime *raw) {
+    switch (i) {
+      case 0:
+        return _rtc0->getRawTimeChecked(raw);
+      case 1:
+        return _rtc1->getRawTimeChecked(raw);
+      default:
+        return _rtc2->getRawTimeChecked(raw);
+    }
+  }
+
+  template <typename RTC>
+  static void _restart(RTC &rtc, const tm *timeptr) {
+    rtc.setTime(timeptr);
+    rtc.setRunning(true);
+  }
+  static void _restart(DS3231 &rtc, const tm *timeptr) {
+    rtc.setTime(timeptr);
+    rtc.setRunning(true);
+    rtc.clearOSF();
+  }
+  static void _restart(RX8025T &rtc, const tm *timeptr) {
+    rtc.setTime(timeptr);
+    rtc.setRunning(true);
+    rtc.clearVLF();
+  }
+
+  void _resync(uint8_t i, const tm *timeptr) {
+    switch (i) {
+      case 0:
+        _restart(*_rtc0, timeptr);
+        break;
+      case 1:
+        _restart(*_rtc1, timeptr);
+        break;
+      default:
+        _restart(*_rtc2, timeptr);
+        break;
+    }
+  }
+
+  static uint32_t _distance(uint32_t a, uint32_t b) { return a > b ? a - b : b - a; }
+
+  uint32_t _predict(uint32_t now) const { return _lastSecs + (now - _lastMillis) / 1000; }
+
+  // raw has status TIME_OK already
+  bool _acceptable(const RawTime &raw, uint32_t now) const {
+    if (!_haveLast) {
+      return true;
+    }
+    // millis() runs off a resonator on many boards, allow it 1%
+    uint32_t elapsed = (now - _lastMillis) / 1000;
+    return _distance(raw.toY2KSeconds(), _predict(now)) <= _maxSkew + elapsed / 100;
+  }
+
+  void _remember(const RawTime &raw, uint32_t now) {
+    _last = raw;
+    _lastSecs = raw.toY2KSeconds();
+    _lastMillis = now;
+    _haveLast = true;
+  }
+};
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef __RTCLIB_SERVICE_H__
+#define __RTCLIB_SERVICE_H__
+
+#include "RTClib.h"
+
+#include <atomic>
+#include <string.h>
+
+#ifdef RTCLIB_LINUX
+#include <chrono>
+#include <thread>
+#endif
+
+// Time cache for many readers. One poller owns the chip and reads it around
+// each seconds rollover; readers get the last published snapshot through a
+// seqlock, consistent and without touching the bus:
+//
+//   TimeService<DS3231> svc(rtc);
+//   svc.start();               // Linux: background thread
+//   ...
+//   TimeService<DS3231>::Snapshot s;
+//   if (svc.read(&s)) { use(s.epoch); }
+//
+// Elsewhere, call poll() from a task of your own, every few ms.
+template <typename RTC>
+class TimeService {
+public:
+  struct Snapshot {
+    RawTime raw;
+    time_t epoch;
+    // number of publications so far
+    uint32_t sequence;
+    // the chip's own verdict, from the same read as raw
+    TimeStatus status;
+    // status == TIME_OK
+    bool valid;
+  };
+
+  explicit TimeService(RTC &rtc) : _rtc {rtc}, _seq {0}, _words {}, _published {false} {}
+
+  ~TimeService() {
+#ifdef RTCLIB_LINUX
+    stop();
+#endif
+  }
+
+  TimeService(const TimeService &) = delete;
+  TimeService &operator=(const TimeService &) = delete;
+
+  // One poller step: reads the chip and publishes if the second or the
+  // status changed. Returns true on a publication. Poller side only.
+  bool poll() {
+    RawTime raw;
+    TimeStatus status = _rtc.getRawTimeChecked(&raw);
+    bool valid = status == TIME_OK;
+
+    if (_published && status == _last.status && raw == _last.raw) {
+      return false;
+    }
+
+    _last.raw = raw;
+    _last.status = status;
+    _last.valid = valid;
+    _last.epoch = valid ? raw.toEpoch() : 0;
+    ++_last.sequence;
+    _publish(_last);
+    _published = true;
+    return true;
+  }
+
+  // latest snapshot; false until the first publication
+  bool read(Snapshot *out) const {
+    uint32_t words[WORDS];
+    uint32_t begin, end;
+
+    do {
+      begin = _seq.load(std::memory_order_acquire);
+      for (uint8_t i = 0; i < WORDS; ++i) {
+        words[i] = _words[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      end = _seq.load(std::memory_order_relaxed);
+    } while (begin != end || (begin & 1));
+
+    if (begin == 0) {
+      return false;
+    }
+    memcpy(out, words, sizeof(Snapshot));
+    return true;
+  }
+
+#ifdef RTCLIB_LINUX
+  // Polls every pollMs around the rollover, and sleeps through the rest of
+  // the second once it has been seen. The rollover counts as seen only when
+  // two valid polls pollMs apart disagree on the seconds; the first
+  // publication, a status change or a poll right after the long sleep do
+  // not place it. From pollMs = 500 on there is nothing left to sleep
+  // through, and it just polls every pollMs.
+  void start(uint16_t pollMs = 5) {
+    if (_thread.joinable()) {
+      return;
+    }
+
+    _running = true;
+    _thread = std::thread([this, pollMs] {
+      using namespace std::chrono;
+
+      // the previous poll was pollMs ago and read a valid time
+      bool armed = false;
+      uint8_t lastSec = 0;
+
+      while (_running.load(std::memory_order_relaxed)) {
+        poll();
+        // poll() leaves _last holding the current reading, published or not
+        uint8_t sec = _last.raw.regs[0];
+        bool rolled = armed && _last.valid && sec != lastSec;
+        armed = _last.valid;
+        lastSec = sec;
+
+        if (rolled && pollMs < 500) {
+          std::this_thread::sleep_for(milliseconds(1000 - 2 * pollMs));
+          armed = false;
+        } else {
+          std::this_thread::sleep_for(milliseconds(pollMs));
+        }
+      }
+    });
+  }
+
+  void stop() {
+    _running = false;
+    if (_thread.joinable()) {
+      _thread.join();
+    }
+  }
+#endif
+
+private:
+  static constexpr uint8_t WORDS = (sizeof(Snapshot) + 3) / 4;
+
+  RTC &_rtc;
+  std::atomic<uint32_t> _seq;
+  std::atomic<uint32_t> _words[WORDS];
+
+  // poller-side copy of what was published last
+  Snapshot _last = {};
+  bool _published;
+
+#ifdef RTCLIB_LINUX
+  std::thread _thread;
+  std::atomic<bool> _running {false};
+#endif
+
+  void _publish(const Snapshot &snap) {
+    uint32_t words[WORDS] = {};
+    memcpy(words, &snap, sizeof(Snapshot));
+
+    uint32_t seq = _seq.load(std::memory_order_relaxed);
+    _seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (uint8_t i = 0; i < WORDS; ++i) {
+      _words[i].store(words[i], std::memory_order_relaxed);
+    }
+    _seq.store(seq + 2, std::memory_order_release);
+  }
+};
+
+#endif
@@ -0,0 +1,261 @@
+#ifndef __RTCLIB_SYNC_H__
+#define __RTCLIB_SYNC_H__
+
+#include "RTClib.h"
+
+// Setting the clock from a PC over a serial line, to within a few ms of the
+// host's clock. The sketch answers a small binary protocol:
+//
+//   TimeSyncServer<DS3231> sync(rtc, Serial);
+//   void loop() { sync.poll(); }
+//
+// and extras/timesync/rtc_timesync drives it: it estimates the link delay
+// from the fastest of several PING round trips, NTP-style, then sends SET
+// early by that delay plus the time setTime() takes, so the seconds register
+// is written right at a host second boundary. Writing the seconds restarts
+// the chip's 1 Hz divider on DS1307, DS3231 and RX8025T. EDGE then reports
+// the next rollover, from which the host reads back the residual offset.
+//
+// Frames are  A5 | cmd | len | payload | sum,  sum being the 8-bit sum of
+// cmd, len and payload. Replies carry cmd | 0x80. Integers are little-endian,
+// device timestamps are micros():
+//
+//   PING  tag[4] pad[3]             -> tag[4] rx[4] tx[4]
+//   SET   s m h mday mon yy wday    -> rx[4] done[4]      binary, yy = year - 2000
+//   GET                             -> y2k[4] valid[1]    seconds since 2000
+//   EDGE  timeout_ms[2]             -> y2k[4] late[4]     late = rollover to tx
+//
+// y2k is 0, and valid false, unless the chip reports TIME_OK: a chip that
+// stopped or lost power has no offset to speak of. SET starts the oscillator
+// and clears OSF/VLF after the write, so the next read is TIME_OK.
+//   bad arguments, timeout          -> NAK (0x7f) cmd[1]
+namespace timesync {
+  constexpr uint8_t SYNC = 0xa5;
+  constexpr uint8_t MAX_PAYLOAD = 12;
+  constexpr uint8_t MAX_FRAME = MAX_PAYLOAD + 4;
+
+  enum Command : uint8_t {
+    CMD_PING = 0x01,
+    CMD_SET = 0x02,
+    CMD_GET = 0x03,
+    CMD_EDGE = 0x04,
+    CMD_NAK = 0x7f,
+    REPLY = 0x80,
+  };
+
+  // PING is padded to the size of SET, so that its round trip measures
+  // what SET will see
+  constexpr uint8_t PING_LEN = 7;
+  constexpr uint8_t SET_LEN = 7;
+
+  inline void put32(uint8_t *p, uint32_t val) {
+    for (uint8_t i = 0; i < 4; ++i) {
+      p[i] = val >> (8 * i);
+    }
+  }
+
+  inline uint32_t get32(const uint8_t *p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+  }
+
+  // returns the frame length, out must hold len + 4 bytes
+  inline uint8_t encode(uint8_t cmd, const uint8_t *payload, uint8_t len, uint8_t *out) {
+    uint8_t sum = cmd + len;
+    out[0] = SYNC;
+    out[1] = cmd;
+    out[2] = len;
+    for (uint8_t i = 0; i < len; ++i) {
+      out[3 + i] = payload[i];
+      sum += payload[i];
+    }
+    out[3 + len] = sum;
+    return len + 4;
+  }
+
+  struct Frame {
+    uint8_t cmd;
+    uint8_t len;
+    uint8_t payload[MAX_PAYLOAD];
+  };
+
+  // Byte-at-a-time decoder. Garbage and bad sums are dropped and decoding
+  // picks up again at the next SYNC.
+  class Parser {
+  public:
+    Parser() : _frame {}, _pos {0}, _sum {0} {}
+
+    // true when val completes a good frame, see frame()
+    bool feed(uint8_t val) {
+      switch (_pos) {
+        case 0:
+          _pos = val == SYNC;
+          return false;
+        case 1:
+          _frame.cmd = val;
+          _sum = val;
+          _pos = 2;
+          return false;
+        case 2:
+          if (val > MAX_PAYLOAD) {
+            _pos = val == SYNC;
+            return false;
+          }
+          _frame.len = val;
+          _sum += val;
+          _pos = 3;
+          return false;
+        default:
+          if (_pos < 3 + _frame.len) {
+            _frame.payload[_pos - 3] = val;
+            _sum += val;
+            ++_pos;
+            return false;
+          }
+          _pos = 0;
+          return val == _sum;
+      }
+    }
+
+    const Frame &frame() const { return _frame; }
+
+  private:
+    Frame _frame;
+    uint8_t _pos;
+    uint8_t _sum;
+  };
+} // namespace timesync
+
+template <typename RTC, typename Port = Stream>
+class TimeSyncServer {
+public:
+  TimeSyncServer(RTC &rtc, Port &port) : _rtc {rtc}, _port {port} {}
+
+  // Answers whatever has arrived. EDGE blocks until the next rollover, up
+  // to the timeout the host asked for. Returns true if a frame was handled.
+  bool poll() {
+    bool handled = false;
+    while (_port.available() > 0) {
+      int val = _port.read();
+      if (val < 0) {
+        break;
+      }
+      if (_parser.feed(val)) {
+        _handle(_parser.frame(), micros());
+        handled = true;
+      }
+    }
+    return handled;
+  }
+
+private:
+  RTC &_rtc;
+  Port &_port;
+  timesync::Parser _parser;
+
+  // PCF8563 clears VL on setTime()
+  template <typename R>
+  static void _markSet(R &rtc) {
+    rtc.setRunning(true);
+  }
+  static void _markSet(DS3231 &rtc) {
+    rtc.setRunning(true);
+    rtc.clearOSF();
+  }
+  static void _markSet(RX8025T &rtc) {
+    rtc.setRunning(true);
+    rtc.clearVLF();
+  }
+
+  void _reply(uint8_t cmd, const uint8_t *payload, uint8_t len) {
+    uint8_t buf[timesync::MAX_FRAME];
+    _port.write(buf, timesync::encode(cmd | timesync::REPLY, payload, len, buf));
+  }
+
+  void _nak(uint8_t cmd) {
+    uint8_t buf[timesync::MAX_FRAME];
+    _port.write(buf, timesync::encode(timesync::CMD_NAK, &cmd, 1, buf));
+  }
+
+  void _handle(const timesync::Frame &f, uint32_t rx) {
+    using namespace timesync;
+    uint8_t out[MAX_PAYLOAD];
+
+    switch (f.cmd) {
+      case CMD_PING:
+        if (f.len != PING_LEN) {
+          break;
+        }
+        memcpy(out, f.payload, 4);
+        put32(out + 4, rx);
+        put32(out + 8, micros());
+        _reply(f.cmd, out, 12);
+        return;
+
+      case CMD_SET: {
+        const uint8_t *p = f.payload;
+        if (f.len != SET_LEN || p[0] > 59 || p[1] > 59 || p[2] > 23 || p[3] < 1 || p[3] > 31 || p[4] < 1 ||
+            p[4] > 12 || p[5] > 99 || p[6] > 6) {
+          break;
+        }
+
+        tm t = {};
+        t.tm_sec = p[0];
+        t.tm_min = p[1];
+        t.tm_hour = p[2];
+        t.tm_mday = p[3];
+        t.tm_mon = p[4] - 1;
+        t.tm_year = p[5] + 100;
+        t.tm_wday = p[6];
+        _rtc.setTime(&t);
+
+        put32(out, rx);
+        put32(out + 4, micros());
+        _reply(f.cmd, out, 8);
+        // after the reply, to keep it as close to the write as before
+        _markSet(_rtc);
+        return;
+      }
+
+      case CMD_GET: {
+        RawTime raw;
+        bool valid = _rtc.getRawTimeChecked(&raw) == TIME_OK;
+        put32(out, valid ? raw.toY2KSeconds() : 0);
+        out[4] = valid;
+        _reply(f.cmd, out, 5);
+        return;
+      }
+
+      case CMD_EDGE: {
+        if (f.len != 2) {
+          break;
+        }
+        uint16_t timeout = f.payload[0] | (f.payload[1] << 8);
+
+        uint8_t first = _rtc.getRawTime().regs[0];
+        uint32_t start = millis();
+        for (;;) {
+          uint32_t before = micros();
+          RawTime raw;
+          // the flags come in the same read, so the timing is unchanged
+          // apart from the longer burst on DS3231 and RX8025T
+          TimeStatus status = _rtc.getRawTimeChecked(&raw);
+          if (raw.regs[0] != first) {
+            uint32_t seen = before + (micros() - before) / 2;
+            put32(out, status == TIME_OK ? raw.toY2KSeconds() : 0);
+            put32(out + 4, micros() - seen);
+            _reply(f.cmd, out, 8);
+            return;
+          }
+          if (millis() - start > timeout) {
+            break;
+          }
+        }
+        break;
+      }
+    }
+
+    _nak(f.cmd);
+  }
+};
+
+#endif